@@ -0,0 +1,178 @@
+#include "ChargeSession.h"
+
+/*
+   Constructor
+*/
+ChargeSession::ChargeSession() {
+  start(0);
+}
+
+void ChargeSession::start(unsigned long time) {
+  m_newestSample = CHARGE_HISTORY_SIZE - 1;
+  m_sampleCount = 0;
+  m_voltageSum = 0;
+  m_currentSum = 0;
+  m_decimationCount = 0;
+  m_startTime = time;
+  m_prevSampleTime = time;
+  m_phase = CHARGE_CC_PHASE;
+  m_ccCurrent = 0;
+  m_cvSampleCount = 0;
+  m_cvStartTime = 0;
+  m_fitCount = 0;
+  m_sumTime = 0;
+  m_sumLogCurrent = 0;
+  m_sumTimeSquared = 0;
+  m_sumTimeLogCurrent = 0;
+  m_energy = 0;
+  m_energyRemainder = 0;
+  m_minutesToFull = CHARGE_UNKNOWN_TIME;
+}
+
+void ChargeSession::addSample(unsigned long time, uint16_t voltage, int16_t current, uint8_t percentage) {
+  uint16_t chargingCurrent = abs(current);
+
+  //integrate power over the time since the previous sample, mV * 0.1A = 0.1mW and 0.1mW * ms / 10000 = mJ
+  uint32_t power = (uint32_t)voltage * chargingCurrent;
+  m_energyRemainder += (uint64_t)power * (time - m_prevSampleTime) / 10000;
+  m_energy += m_energyRemainder / 3600;
+  m_energyRemainder %= 3600;
+  m_prevSampleTime = time;
+
+  m_voltageSum += voltage;
+  m_currentSum += chargingCurrent;
+  if (++m_decimationCount < CHARGE_DECIMATION) {
+    return;
+  }
+
+  ChargeSample sample;
+  sample.time = (time - m_startTime) / 1000;
+  sample.voltage = m_voltageSum / CHARGE_DECIMATION;
+  sample.current = m_currentSum / CHARGE_DECIMATION;
+  m_voltageSum = 0;
+  m_currentSum = 0;
+  m_decimationCount = 0;
+  addHistorySample(sample, percentage);
+}
+
+uint8_t ChargeSession::phase() {
+  return m_phase;
+}
+
+uint16_t ChargeSession::minutesToFull() {
+  return m_minutesToFull;
+}
+
+uint32_t ChargeSession::energy() {
+  return m_energy;
+}
+
+uint8_t ChargeSession::sampleCount() {
+  return m_sampleCount;
+}
+
+ChargeSample ChargeSession::sample(uint8_t age) {
+  return m_history[(m_newestSample + CHARGE_HISTORY_SIZE - age) % CHARGE_HISTORY_SIZE];
+}
+
+/*
+
+
+
+    Private helper functions
+
+
+
+*/
+
+void ChargeSession::addHistorySample(const ChargeSample& sample, uint8_t percentage) {
+  m_newestSample = (m_newestSample + 1) % CHARGE_HISTORY_SIZE;
+  m_history[m_newestSample] = sample;
+  if (m_sampleCount < CHARGE_HISTORY_SIZE) {
+    ++m_sampleCount;
+  }
+
+  if (m_phase == CHARGE_CV_PHASE) {
+    addFitSample(sample);
+  }
+  else if (sample.current >= m_ccCurrent) {
+    m_ccCurrent = sample.current;
+    m_cvSampleCount = 0;
+  }
+  else if ((uint32_t)sample.current * 256 < (uint32_t)m_ccCurrent * CHARGE_CV_CURRENT_RATIO_Q8) {
+    //the current has to stay low for a few samples so a dip in the charger's output isn't taken as CV
+    if (++m_cvSampleCount == CHARGE_CV_CONFIRM_SAMPLES) {
+      Serial.println("Charging switched to constant voltage");
+      m_phase = CHARGE_CV_PHASE;
+      //the taper started with the first of the confirming samples, fit those from the history too
+      m_cvStartTime = this->sample(CHARGE_CV_CONFIRM_SAMPLES - 1).time;
+      for (int8_t age = CHARGE_CV_CONFIRM_SAMPLES - 1; age >= 0; --age) {
+        addFitSample(this->sample(age));
+      }
+    }
+  }
+  else {
+    m_cvSampleCount = 0;
+  }
+
+  updateEstimate(sample, percentage);
+}
+
+void ChargeSession::addFitSample(const ChargeSample& sample) {
+  //ln(0) is undefined, the charge is about to finish anyway
+  if (sample.current == 0) {
+    return;
+  }
+  float time = (sample.time - m_cvStartTime) / 60.0;
+  float logCurrent = log(sample.current);
+  ++m_fitCount;
+  m_sumTime += time;
+  m_sumLogCurrent += logCurrent;
+  m_sumTimeSquared += time * time;
+  m_sumTimeLogCurrent += time * logCurrent;
+}
+
+void ChargeSession::updateEstimate(const ChargeSample& sample, uint8_t percentage) {
+  //the charger hasn't started yet
+  if (sample.current == 0 && m_ccCurrent == 0) {
+    m_minutesToFull = CHARGE_UNKNOWN_TIME;
+    return;
+  }
+  if (sample.current <= BatteryPack::terminationCurrent) {
+    m_minutesToFull = 0;
+    return;
+  }
+
+  if (m_phase == CHARGE_CC_PHASE) {
+    //until there's a taper to fit, assume the remaining capacity goes in at the present current
+    uint32_t remainingCapacity = BatteryPack::capacity * (100 - percentage) / 100;
+    m_minutesToFull = min(remainingCapacity * 60 / ((uint32_t)sample.current * 100), (uint32_t)CHARGE_UNKNOWN_TIME - 1);
+    return;
+  }
+
+  //ln(current) = intercept + slope * time, the current reaches the termination current at
+  //time = (ln(termination current) - intercept) / slope
+  float denominator = m_fitCount * m_sumTimeSquared - m_sumTime * m_sumTime;
+  if (m_fitCount < CHARGE_CV_CONFIRM_SAMPLES || denominator <= 0) {
+    m_minutesToFull = CHARGE_UNKNOWN_TIME;
+    return;
+  }
+  float slope = (m_fitCount * m_sumTimeLogCurrent - m_sumTime * m_sumLogCurrent) / denominator;
+  float intercept = (m_sumLogCurrent - slope * m_sumTime) / m_fitCount;
+  //a current that isn't tapering off gives no estimate
+  if (slope >= 0) {
+    m_minutesToFull = CHARGE_UNKNOWN_TIME;
+    return;
+  }
+  float fullTime = (log(BatteryPack::terminationCurrent) - intercept) / slope;
+  float minutesToFull = fullTime - (sample.time - m_cvStartTime) / 60.0;
+  if (minutesToFull < 0) {
+    m_minutesToFull = 0;
+  }
+  else if (minutesToFull >= CHARGE_UNKNOWN_TIME) {
+    m_minutesToFull = CHARGE_UNKNOWN_TIME - 1;
+  }
+  else {
+    m_minutesToFull = minutesToFull + 0.5;
+  }
+}
@@ -0,0 +1,109 @@
+/*
+  Tracks a charge from start to full. Voltage and current samples are averaged into a decimated history
+  kept in a ring buffer, which is used to detect the change from constant current (CC) to constant
+  voltage (CV) charging. In the CV phase the current tapers off exponentially, so ln(current) is fit
+  against time with a least-squares line. The fit only keeps running sums, so every sample is an O(1)
+  update, and the time until the current reaches the battery's termination current is estimated from it.
+*/
+
+#ifndef CHARGE_SESSION_H
+#define CHARGE_SESSION_H
+
+#include <Arduino.h>
+#include "Profiles.h"
+
+#define CHARGE_HISTORY_SIZE 64
+//raw samples averaged into each history sample
+#define CHARGE_DECIMATION 10
+//the CV phase starts once the current stays below 90% of the CC current
+#define CHARGE_CV_CURRENT_RATIO_Q8 230
+#define CHARGE_CV_CONFIRM_SAMPLES 3
+//time to full before there's enough to estimate it from
+#define CHARGE_UNKNOWN_TIME 0xFFFF
+
+enum ChargePhases {
+  CHARGE_CC_PHASE,
+  CHARGE_CV_PHASE,
+};
+
+struct ChargeSample {
+  uint32_t time; //seconds since the charge started
+  uint16_t voltage; //average voltage in millivolts
+  uint16_t current; //average charging current in 0.1A
+};
+
+class ChargeSession {
+
+  private:
+    ChargeSample m_history[CHARGE_HISTORY_SIZE];
+    uint8_t m_newestSample; //index of the newest sample in m_history
+    uint8_t m_sampleCount;
+    //sums of the raw samples being averaged into the next history sample
+    uint32_t m_voltageSum;
+    uint32_t m_currentSum;
+    uint8_t m_decimationCount;
+    unsigned long m_startTime;
+    unsigned long m_prevSampleTime;
+
+    uint8_t m_phase;
+    uint16_t m_ccCurrent; //highest charging current in the CC phase in 0.1A
+    uint8_t m_cvSampleCount; //history samples in a row below the CV threshold
+    uint32_t m_cvStartTime; //seconds since the charge started
+
+    //least-squares sums of ln(current) against minutes since the CV phase started
+    uint16_t m_fitCount;
+    float m_sumTime;
+    float m_sumLogCurrent;
+    float m_sumTimeSquared;
+    float m_sumTimeLogCurrent;
+
+    uint32_t m_energy; //energy delivered in milliwatt-hours
+    uint32_t m_energyRemainder; //energy in millijoules not yet counted in m_energy
+    uint16_t m_minutesToFull;
+
+    /*
+      Adds an averaged sample to the history and updates the phase and the fit with it
+    */
+    void addHistorySample(const ChargeSample& sample, uint8_t percentage);
+    /*
+      Adds a history sample to the least-squares fit of the CV phase
+    */
+    void addFitSample(const ChargeSample& sample);
+    /*
+      Estimates the time to full from the fit in the CV phase, or from the remaining capacity in the CC phase
+    */
+    void updateEstimate(const ChargeSample& sample, uint8_t percentage);
+
+  public:
+    ChargeSession();
+    /*
+      Starts a new charge, clearing the history and the estimate
+      @param time is the current time in milliseconds
+    */
+    void start(unsigned long time);
+    /*
+      Adds a raw sample, call at a regular interval while charging
+      @param time is the current time in milliseconds
+      @param voltage is the battery voltage in millivolts
+      @param current is the battery current in 0.1A, either direction counts as charging
+      @param percentage is the battery's state of charge
+    */
+    void addSample(unsigned long time, uint16_t voltage, int16_t current, uint8_t percentage);
+    uint8_t phase();
+    /*
+      Returns the estimated minutes until the battery is full, or CHARGE_UNKNOWN_TIME
+    */
+    uint16_t minutesToFull();
+    /*
+      Returns the energy delivered since the charge started in milliwatt-hours
+    */
+    uint32_t energy();
+    uint8_t sampleCount();
+    /*
+      Returns a sample from the history
+      @param age is 0 for the newest sample, up to sampleCount() - 1 for the oldest
+    */
+    ChargeSample sample(uint8_t age);
+};
+
+#endif
@@ -0,0 +1,26 @@
+/*
+  CRC-8 with the polynomial 0x07, checks the EEPROM records, the RAM kept across a reset and the
+  telemetry packets
+*/
+
+#ifndef CRC8_H
+#define CRC8_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+  Returns the CRC-8 of a block of bytes
+  @param crc is the CRC of the bytes before the block, to continue over a block that was split in two
+*/
+inline uint8_t crc8(const uint8_t* data, size_t length, uint8_t crc = 0) {
+  for (size_t i = 0; i < length; ++i) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+#endif
@@ -1,7 +1,8 @@
 #include "Dashboard.h"
+#include "FixedTrig.h"
 
 //create battery object
-Battery battery(BATT_MIN_VOLTAGE, BATT_MAX_VOLTAGE, BATT_VOLTAGE_SENSE_PIN);
+Battery battery(BatteryPack::minVoltage, BatteryPack::maxVoltage, BATT_VOLTAGE_SENSE_PIN);
 //voltage reference for battery sense
 VoltageReference vRef = VoltageReference();
 
@@ -14,6 +15,44 @@ uint16_t prevBatteryVoltage = 0;
 int8_t prevBatteryCurrent = 0;
 int8_t prevBatteryTemperature = 0;
 uint8_t prevSpeed = 0;
+//speed the gauge needle is currently drawn at
+uint8_t gaugeNeedleSpeed = 0;
+//trip time in seconds and loop time currently displayed
+unsigned long prevTripSeconds = 0;
+unsigned long prevDiagnosticsUpdateTime = 0;
+unsigned long prevPerformanceUpdateTime = 0;
+uint8_t prevPerformanceState = PERFORMANCE_WAITING;
+//time of the first tap on the best times, clearing them waits for a second one
+unsigned long prevClearBestRunTapTime = 0;
+bool isClearBestRunPending = false;
+//time of the previous dashboard display update, used to measure the loop time
+unsigned long prevDisplayUpdateTime = 0;
+unsigned long loopTime = 0;
+unsigned long prevChartSampleTime = 0;
+unsigned long prevChargeSampleTime = 0;
+unsigned long prevChargeEstimateTime = 0;
+uint16_t prevMinutesToFull = CHARGE_UNKNOWN_TIME;
+uint32_t prevChargeEnergy = 0;
+
+//state of the background reference voltage measurement
+bool isMeasuringVcc = false; //the bandgap is selected and settling
+unsigned long vccMeasurementStartTime = 0; //time the bandgap was selected in microseconds
+unsigned long prevVccMeasurementTime = 0; //time of the last finished measurement in milliseconds
+uint32_t vccCalibration = DEFAULT_VREF_CALIBRATION;
+uint16_t batteryRefVoltage = 0; //reference voltage the battery library is using
+
+//time the last packet from the motor controller and the BMS was received in milliseconds
+unsigned long controllerPacketTime = 0;
+unsigned long bmsPacketTime = 0;
+bool hasControllerPacket = false;
+bool hasBmsPacket = false;
+
+//queue of touches waiting to be handled, filled by touchInterrupt() and emptied by updateTouchEvents()
+volatile unsigned long touchEventTimes[TOUCH_QUEUE_SIZE];
+volatile uint8_t touchEventHead = 0; //only written by the interrupt
+volatile uint8_t touchEventTail = 0; //only written by the main loop
+unsigned long prevTouchEventTime = 0;
+uint16_t touchEventCount = 0;
 
 //time at the end of the previous call to update speed
 volatile long prevSignalTime = 0; 
@@ -26,31 +65,69 @@ volatile uint8_t pulses = 0;
 /*
    Constructor
 */
-Dashboard::Dashboard(Adafruit_RA8875 tft)
+Dashboard::Dashboard(Adafruit_RA8875 tft, uint8_t touchInterruptPin)
   : m_display(tft), m_isCharging(false), m_warnings{false, false, false, false}
   , m_batteryVoltage(0), m_batteryPercentage(0), m_batteryTemperature(0)
   , m_isLeftOn(false), m_isRightOn(false), m_isLoOn(false), m_isHiOn(false)
-  , m_speed(0), m_refVoltage(0), m_batteryCurrent(0)
+  , m_speed(0), m_refVoltage(0), m_batteryCurrent(0), m_preciseBatteryCurrent(0)
+  , m_touchInterruptPin(touchInterruptPin), m_page(MAIN_PAGE)
+  , m_tripStartTime(0), m_tripMaxSpeed(0)
+  , m_batteryVoltageChart(CHART_X, BATT_VOLTAGE_CHART_Y, BatteryPack::minVoltage, BatteryPack::maxVoltage, RA8875_GREEN)
+  , m_batteryTemperatureChart(CHART_X, BATT_TEMP_CHART_Y, BatteryPack::minTemp, BatteryPack::maxTemp, RA8875_RED)
+  , m_batteryCurrentChart(CHART_X, BATT_CURRENT_CHART_Y, BatteryPack::minCurrent, BatteryPack::maxCurrent, RA8875_BLUE)
+  , m_motorRpm(0), m_phaseCurrent(0), m_controllerTemperature(0), m_controllerFaults(0), m_bmsFaults(0)
+  , m_cellCount(0)
 {
 }
 
 void Dashboard::begin() {
+  //start the watchdog first so nothing below can hang forever
+  m_monitor.begin();
+
   //initialize display with 800x480 resolution
   if (!m_display.begin(RA8875_800x480)) {
     Serial.println("Display not found");
+    //wait for the watchdog to reset and try again
+    m_monitor.recordFault(SETUP_TASK, FAULT_NO_DISPLAY, 0);
     while (1);
   }
   Serial.println("Starting display");
 
-  //read the reference voltage
-  vRef.begin(EEPROM.read(VREF_EEPROM_ADDR), EEPROM.read(VREF_EEPROM_ADDR + 1), EEPROM.read(VREF_EEPROM_ADDR + 2));
+  //read the reference voltage, it's tracked in the background from here on
+  uint8_t calibrationHigh = EEPROM.read(VREF_EEPROM_ADDR);
+  uint8_t calibrationMid = EEPROM.read(VREF_EEPROM_ADDR + 1);
+  uint8_t calibrationLow = EEPROM.read(VREF_EEPROM_ADDR + 2);
+  vRef.begin(calibrationHigh, calibrationMid, calibrationLow);
   m_refVoltage = vRef.readVcc();
+  uint32_t calibration = ((uint32_t)calibrationHigh << 16) | ((uint32_t)calibrationMid << 8) | calibrationLow;
+  //erased EEPROM reads as 0xFF
+  if (calibration != 0 && calibration != 0xFFFFFF) {
+    vccCalibration = calibration;
+  }
+  prevVccMeasurementTime = millis();
 
   //initialize battery library with board's reference voltage and voltage divider's ratio
-  battery.begin(m_refVoltage, DIVIDER_RATIO);
+  battery.begin(m_refVoltage, BatteryPack::dividerRatio);
+  batteryRefVoltage = m_refVoltage;
+
+  //load odometer and trip meters
+  m_odometer.begin();
+
+  //a reset in the middle of a ride keeps the distance from before it
+  if (m_monitor.hasSavedState()) {
+    const MonitorSnapshot& state = m_monitor.savedState();
+    m_odometer.restore(state.totalPulses, state.tripPulses);
+  }
+
+  //load the best performance run
+  m_performanceTimer.begin();
+
+  //start receiving telemetry from the motor controller and BMS
+  m_telemetry.begin();
 
   //set the sense pins as inputs
   pinMode(CHARGE_SENSE_PIN, INPUT);
+  pinMode(POWER_SENSE_PIN, INPUT);
   pinMode(LEFT_LIGHT_SENSE_PIN, INPUT);
   pinMode(RIGHT_LIGHT_SENSE_PIN, INPUT);
   pinMode(LO_LIGHT_SENSE_PIN, INPUT);
@@ -68,6 +145,11 @@ void Dashboard::begin() {
   m_display.PWM1config(true, RA8875_PWM_CLK_DIV1024); // PWM output for backlight
   m_display.PWM1out(255);
 
+  //queue touches on the display's interrupt instead of polling the touch controller
+  m_display.touchEnable(true);
+  pinMode(m_touchInterruptPin, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(m_touchInterruptPin), touchInterrupt, FALLING);
+
   initDashboard();
 }
 
@@ -82,30 +164,88 @@ void Dashboard::initDashboard() {
   updateBatteryDisplay();
   drawLightIndicators();
   drawWarningBox();
+  drawPageTabs();
+  drawPage();
+}
 
-  //dashboard if battery's not charging
-  if (!isCharging()) {
-    drawSpeedIndicator();
-    updateSpeedDisplay();
-  }
-  //dashboard if battery's charging
-  else {
-    drawBatteryVoltageDisplay();
-    drawBatteryTemperatureDisplay();
-    drawBatteryCurrentDisplay();
+void Dashboard::showPage(uint8_t page) {
+  Serial.println("Showing page");
+  m_page = page;
+
+  //only clear the page area, the battery, lights and warnings stay the same on every page
+  m_display.graphicsMode();
+  m_display.fillRect(0, 0, PAGE_AREA_WIDTH, PAGE_AREA_HEIGHT, RA8875_WHITE);
+  drawPageTabs();
+  drawPage();
+}
+
+void Dashboard::drawPage() {
+  Serial.println("Drawing page");
+  switch (m_page) {
+    case MAIN_PAGE:
+      drawSpeedIndicator();
+      updateSpeedDisplay();
+      return;
+    case CHARGING_PAGE:
+      drawBatteryVoltageDisplay();
+      drawBatteryTemperatureDisplay();
+      drawBatteryCurrentDisplay();
+      updateBatteryVoltageDisplay();
+      updateBatteryTemperatureDisplay();
+      updateBatteryCurrentDisplay();
+      m_batteryVoltageChart.draw(m_display);
+      m_batteryTemperatureChart.draw(m_display);
+      m_batteryCurrentChart.draw(m_display);
+      drawChargeEstimateDisplay();
+      updateChargeEstimateDisplay();
+      return;
+    case TRIP_PAGE:
+      drawTripDisplay();
+      updateTripDisplay();
+      return;
+    case DIAGNOSTICS_PAGE:
+      drawDiagnosticsDisplay();
+      updateDiagnosticsDisplay();
+      return;
+    case PERFORMANCE_PAGE:
+      drawPerformanceDisplay();
+      updatePerformanceDisplay();
+      updatePerformanceRunDisplay();
+      return;
+    default: Serial.println("Wrong page!"); return;
   }
 }
 
 void Dashboard::updateDashboardDisplay() {
   Serial.println("Updating dashboard display");
+  unsigned long currentTime = millis();
+  loopTime = currentTime - prevDisplayUpdateTime;
+  prevDisplayUpdateTime = currentTime;
+
   bool chargingStateChanged = updateChargingState();
 
-  //if charging state's changed, reset the dashboard display
+  //if charging state's changed, reset the dashboard display and show the page for the new state
   if (chargingStateChanged) {
     reset();
+    m_page = isCharging() ? CHARGING_PAGE : MAIN_PAGE;
+    //start new charts for every charge
+    if (isCharging()) {
+      m_batteryVoltageChart.clear();
+      m_batteryTemperatureChart.clear();
+      m_batteryCurrentChart.clear();
+      prevChartSampleTime = currentTime;
+      m_chargeSession.start(currentTime);
+      prevChargeSampleTime = currentTime;
+    }
     initDashboard();
   }
 
+  updateTouchEvents();
+  //pulses are only timed while the performance page is shown
+  m_performanceTimer.setEnabled(m_page == PERFORMANCE_PAGE);
+  updateCharts(currentTime);
+  updateChargeSession(currentTime);
+
   //only update battery percentage display if the percentage difference is >= battery percentage error
   int8_t batteryPercentageDifference = abs(m_batteryPercentage - prevBatteryPercentage);
   if (batteryPercentageDifference >= BATT_PERCENT_ERROR) {
@@ -114,24 +254,55 @@ void Dashboard::updateDashboardDisplay() {
 
   updateLightsDisplay();
 
-  //updates to display when running on battery
-  if (!isCharging()) {
-    if (prevSpeed != m_speed) {
-      updateSpeedDisplay();
-    }
-  }
-
-  //updates to display when battery's charging
-  else {
-    if (prevBatteryVoltage != m_batteryVoltage) {
-      updateBatteryVoltageDisplay();
-    }
-    if (prevBatteryTemperature != m_batteryTemperature) {
-      updateBatteryTemperatureDisplay();
-    }
-    if (prevBatteryCurrent != m_batteryCurrent) {
-      updateBatteryCurrentDisplay();
-    }
+  //updates to the page currently shown
+  switch (m_page) {
+    case MAIN_PAGE:
+      if (prevSpeed != m_speed) {
+        updateSpeedDisplay();
+      }
+      return;
+    case CHARGING_PAGE:
+      if (prevBatteryVoltage != m_batteryVoltage) {
+        updateBatteryVoltageDisplay();
+      }
+      if (prevBatteryTemperature != m_batteryTemperature) {
+        updateBatteryTemperatureDisplay();
+      }
+      if (prevBatteryCurrent != m_batteryCurrent) {
+        updateBatteryCurrentDisplay();
+      }
+      //the estimate changes slowly, don't redraw it on every change
+      if (currentTime - prevChargeEstimateTime >= CHARGE_ESTIMATE_INTERVAL_MS
+          && (prevMinutesToFull != m_chargeSession.minutesToFull() || prevChargeEnergy / 1000 != m_chargeSession.energy() / 1000)) {
+        updateChargeEstimateDisplay();
+      }
+      return;
+    case TRIP_PAGE:
+      //trip time is displayed in seconds
+      if ((currentTime - m_tripStartTime) / 1000 != prevTripSeconds) {
+        updateTripDisplay();
+      }
+      return;
+    case DIAGNOSTICS_PAGE:
+      if (currentTime - prevDiagnosticsUpdateTime >= 1000) {
+        updateDiagnosticsDisplay();
+      }
+      return;
+    case PERFORMANCE_PAGE:
+      if (currentTime - prevPerformanceUpdateTime >= PERFORMANCE_DISPLAY_INTERVAL_MS) {
+        updatePerformanceDisplay();
+      }
+      //the run's times only change when it starts or finishes
+      if (prevPerformanceState != m_performanceTimer.state()) {
+        updatePerformanceRunDisplay();
+      }
+      //no second tap, show the run's state again
+      if (isClearBestRunPending && currentTime - prevClearBestRunTapTime >= PERFORMANCE_CLEAR_CONFIRM_MS) {
+        isClearBestRunPending = false;
+        updatePerformanceRunDisplay();
+      }
+      return;
+    default: return;
   }
 }
 
@@ -144,34 +315,52 @@ void Dashboard::updateWarningsDisplay() {
   }
   updateBatteryOverheatDisplay();
   updateBatteryLowTemperatureDisplay();
-  //updateBatteryImbalanceDisplay();
+  updateBatteryImbalanceDisplay();
 }
 
 void Dashboard::updateBatteryPercentage() {
   Serial.println("Updating battery percentage");
 
+  //the bandgap selected at the end of the previous loop has settled by now
+  finishReferenceMeasurement();
+
   //update battery percentage
   prevBatteryPercentage = m_batteryPercentage;
+  //the BMS telemetry replaces the analog sensing while it's being received
+  if (isBmsTelemetryFresh()) {
+    prevBatteryVoltage = m_batteryVoltage;
+    return;
+  }
   updateBatteryVoltage();
-  m_batteryPercentage = battery.level(m_batteryVoltage);
+  m_batteryPercentage = stateOfCharge(m_batteryVoltage);
 }
 
 void Dashboard::updateBatteryTemperature() {
   Serial.println("Updating battery temperature");
   prevBatteryTemperature = m_batteryTemperature;
+  if (isBmsTelemetryFresh()) {
+    return;
+  }
   //TODO: rewrite the algorithm so that it scales with the minimum and maximum voltage inputs from the sensor
   //because the actual values won't be exactly between 0 & 5V
   //scale reading (0-1023, mapped between 0-5V) to temperature
-  m_batteryTemperature = (long)analogRead(BATT_TEMP_SENSE_PIN) * (BATT_MAX_TEMP - BATT_MIN_TEMP) / 1024 + BATT_MIN_TEMP;
+  m_batteryTemperature = ((long)readCorrectedAnalog(BATT_TEMP_SENSE_PIN) * TEMP_SCALE_Q16 >> 16) + BatteryPack::minTemp;
 }
 
 void Dashboard::updateBatteryCurrent() {
   Serial.println("Updating battery current");
   prevBatteryCurrent = m_batteryCurrent;
-  //TODO: rewrite the algorithm so that it scales with the minimum and maximum voltage inputs from the sensor
-  //because the actual values won't be exactly between 0 & 5V
-  //scale reading to current
-  m_batteryCurrent = (long)analogRead(BATT_CURRENT_SENSE_PIN) * (BATT_MAX_CURRENT - BATT_MIN_CURRENT) / 1024 + BATT_MIN_CURRENT;
+  if (!isBmsTelemetryFresh()) {
+    //TODO: rewrite the algorithm so that it scales with the minimum and maximum voltage inputs from the sensor
+    //because the actual values won't be exactly between 0 & 5V
+    //scale reading to current
+    uint16_t reading = readCorrectedAnalog(BATT_CURRENT_SENSE_PIN);
+    m_batteryCurrent = ((long)reading * CURRENT_SCALE_Q16 >> 16) + BatteryPack::minCurrent;
+    m_preciseBatteryCurrent = ((long)reading * CURRENT_SCALE_Q16 * 10 >> 16) + BatteryPack::minCurrent * 10;
+  }
+
+  //this is the loop's last analog reading, let the bandgap settle during the rest of the loop
+  startReferenceMeasurement();
 }
 
 void Dashboard::updateLightStates() {
@@ -185,19 +374,65 @@ void Dashboard::updateLightStates() {
 void Dashboard::updateSpeed() {
   Serial.println("Updating speed");
   prevSpeed = m_speed;
-  long distanceTraveledInches = WHEEL_DIAMETER_INCHES * PI * pulses;
+  m_performanceTimer.update();
+
+  //take the pulses counted by the interrupt so none get lost between reading and clearing them
+  noInterrupts();
+  uint8_t pulseCount = pulses;
+  pulses = 0;
+  interrupts();
+  m_odometer.addPulses(pulseCount);
+
+  //the controller's RPM replaces the wheel sensor while it's being received, the pulses still count for the odometer
+  if (isControllerTelemetryFresh()) {
+    prevSignalTime = micros();
+    return;
+  }
+
   long timeElapsedMicroseconds = currentSignalTime - prevSignalTime;
-  long currentSpeed = distanceTraveledInches * 56818 / timeElapsedMicroseconds; //convert speed from in/ms to mph
-  if(currentSpeed > MAX_SPEED){
-    m_speed = MAX_SPEED;
+  //the wheel circumference and the conversion from in/us to mph are folded into SPEED_SCALE
+  unsigned long currentSpeed = pulseCount * SPEED_SCALE / timeElapsedMicroseconds;
+  if(currentSpeed > Vehicle::maxSpeed){
+    m_speed = Vehicle::maxSpeed;
   }
   else{
     m_speed = currentSpeed;
   }
-  pulses = 0;
+  if (m_speed > m_tripMaxSpeed) {
+    m_tripMaxSpeed = m_speed;
+  }
   prevSignalTime = micros();
 }
 
+void Dashboard::updateTelemetry() {
+  Serial.println("Updating telemetry");
+  readTelemetry();
+}
+
+void Dashboard::startTask(uint8_t task) {
+  m_monitor.startTask(task);
+  readTelemetry();
+}
+
+void Dashboard::updateMonitor() {
+  uint32_t tripPulses[ODOMETER_TRIP_COUNT];
+  for (uint8_t trip = 0; trip < ODOMETER_TRIP_COUNT; ++trip) {
+    tripPulses[trip] = m_odometer.tripPulses(trip);
+  }
+  m_monitor.saveState(m_odometer.totalPulses(), tripPulses);
+
+  while (Serial.available() > 0) {
+    if (Serial.read() == MONITOR_REPORT_COMMAND) {
+      m_monitor.printReport();
+    }
+  }
+}
+
+void Dashboard::updateOdometer() {
+  Serial.println("Updating odometer");
+  m_odometer.update(digitalRead(POWER_SENSE_PIN) == HIGH);
+}
+
 /*
 
 
@@ -233,12 +468,80 @@ bool Dashboard::updateChargingState() {
 
 void Dashboard::drawSpeedIndicator() {
   Serial.println("Drawing speed indicator");
+#ifdef SPEED_GAUGE
+  drawSpeedGauge();
+#else
   m_display.textMode();
   m_display.textTransparent(RA8875_BLACK);
   char mphString[] = "mph";
   m_display.textEnlarge(3);
   m_display.textSetCursor(420, 200);
   m_display.textWrite(mphString);
+#endif
+}
+
+void Dashboard::drawSpeedGauge() {
+  Serial.println("Drawing speed gauge");
+
+  //draw tick marks
+  m_display.graphicsMode();
+  for (uint8_t speed = 0; speed <= Vehicle::maxSpeed; speed += GAUGE_TICK_STEP) {
+    drawSpeedGaugeTick(speed);
+  }
+
+  //draw labels outside the tick marks so the needle never covers them
+  m_display.textMode();
+  m_display.textTransparent(RA8875_BLACK);
+  m_display.textEnlarge(0);
+  for (uint8_t speed = 0; speed <= Vehicle::maxSpeed; speed += GAUGE_LABEL_STEP) {
+    int16_t angle = speedToGaugeAngle(speed);
+    char labelString[4];
+    itoa(speed, labelString, 10);
+    //center the label (8x16 pixels per character) on its position
+    int16_t labelX = GAUGE_CENTER_X + fixedScale(GAUGE_LABEL_RADIUS, fixedCos(angle)) - strlen(labelString) * 4;
+    int16_t labelY = GAUGE_CENTER_Y - fixedScale(GAUGE_LABEL_RADIUS, fixedSin(angle)) - 8;
+    m_display.textSetCursor(labelX, labelY);
+    m_display.textWrite(labelString);
+  }
+
+  //draw unit under the numeric speed readout
+  m_display.textEnlarge(1);
+  m_display.textSetCursor(GAUGE_CENTER_X - 24, GAUGE_CENTER_Y + 80);
+  char mphString[] = "mph";
+  m_display.textWrite(mphString);
+
+  //draw needle at 0 mph
+  m_display.graphicsMode();
+  gaugeNeedleSpeed = 0;
+  drawSpeedGaugeNeedle(gaugeNeedleSpeed, RA8875_RED);
+  m_display.fillCircle(GAUGE_CENTER_X, GAUGE_CENTER_Y, GAUGE_HUB_RADIUS, RA8875_BLACK);
+}
+
+void Dashboard::drawSpeedGaugeTick(uint8_t speed) {
+  int16_t angle = speedToGaugeAngle(speed);
+  int16_t cosine = fixedCos(angle);
+  int16_t sine = fixedSin(angle);
+  uint8_t innerRadius = (speed % GAUGE_LABEL_STEP == 0) ? GAUGE_MAJOR_TICK_INNER_RADIUS : GAUGE_TICK_INNER_RADIUS;
+
+  //screen y grows downwards, so the sine term is subtracted
+  m_display.drawLine(GAUGE_CENTER_X + fixedScale(innerRadius, cosine), GAUGE_CENTER_Y - fixedScale(innerRadius, sine),
+                     GAUGE_CENTER_X + fixedScale(GAUGE_TICK_OUTER_RADIUS, cosine), GAUGE_CENTER_Y - fixedScale(GAUGE_TICK_OUTER_RADIUS, sine),
+                     RA8875_BLACK);
+}
+
+void Dashboard::drawSpeedGaugeNeedle(uint8_t speed, uint16_t color) {
+  int16_t angle = speedToGaugeAngle(speed);
+  int16_t cosine = fixedCos(angle);
+  int16_t sine = fixedSin(angle);
+
+  //the needle is a thin triangle from the hub to the tip, its base is perpendicular to the needle
+  int16_t tipX = GAUGE_CENTER_X + fixedScale(GAUGE_NEEDLE_LENGTH, cosine);
+  int16_t tipY = GAUGE_CENTER_Y - fixedScale(GAUGE_NEEDLE_LENGTH, sine);
+  int16_t baseOffsetX = fixedScale(GAUGE_NEEDLE_HALF_WIDTH, sine);
+  int16_t baseOffsetY = fixedScale(GAUGE_NEEDLE_HALF_WIDTH, cosine);
+  m_display.fillTriangle(GAUGE_CENTER_X + baseOffsetX, GAUGE_CENTER_Y + baseOffsetY,
+                         GAUGE_CENTER_X - baseOffsetX, GAUGE_CENTER_Y - baseOffsetY,
+                         tipX, tipY, color);
 }
 
 void Dashboard::drawBatteryOutline() {
@@ -323,7 +626,7 @@ void Dashboard::updateBatteryDisplay() {
   //battery display when not charging
   if (!isCharging()) {
     //Fill in battery. > 20% = green, <= 20% = red
-    if (m_batteryPercentage > LOW_BATT_THRESHOLD) {
+    if (m_batteryPercentage > BatteryPack::lowBatteryThreshold) {
       m_display.fillRect(579, 11, m_batteryPercentage, 48, RA8875_GREEN);
     }
     else {
@@ -359,10 +662,450 @@ void Dashboard::updateBatteryDisplay() {
   }
 }
 
+void Dashboard::drawPageTabs() {
+  Serial.println("Drawing page tabs");
+  const char* pageNames[PAGE_COUNT] = {"Main", "Charge", "Trip", "Diag", "Perf"};
+
+  for (uint8_t page = 0; page < PAGE_COUNT; ++page) {
+    uint16_t tabX = page * PAGE_TAB_WIDTH;
+    //highlight the tab of the page currently shown
+    m_display.graphicsMode();
+    m_display.fillRect(tabX + 5, PAGE_TAB_Y, PAGE_TAB_WIDTH - 10, PAGE_TAB_HEIGHT, (page == m_page) ? RA8875_CYAN : RA8875_WHITE);
+    m_display.drawRect(tabX + 5, PAGE_TAB_Y, PAGE_TAB_WIDTH - 10, PAGE_TAB_HEIGHT, RA8875_BLACK);
+
+    //center the name (8x16 pixels per character) in the tab
+    m_display.textMode();
+    m_display.textTransparent(RA8875_BLACK);
+    m_display.textEnlarge(0);
+    m_display.textSetCursor(tabX + PAGE_TAB_WIDTH / 2 - strlen(pageNames[page]) * 4, PAGE_TAB_Y + 7);
+    m_display.textWrite(pageNames[page]);
+  }
+}
+
+void Dashboard::drawTripDisplay() {
+  Serial.println("Drawing trip display");
+  m_display.textMode();
+  m_display.textTransparent(RA8875_BLACK);
+  m_display.textEnlarge(1);
+  m_display.textSetCursor(50, 75);
+  char tripTimeString[] = "Trip time: ";
+  m_display.textWrite(tripTimeString);
+  m_display.textSetCursor(50, 125);
+  char maxSpeedString[] = "Max speed: ";
+  m_display.textWrite(maxSpeedString);
+  m_display.textSetCursor(355, 125);
+  char mphString[] = "mph";
+  m_display.textWrite(mphString);
+  m_display.textSetCursor(50, 175);
+  char tripAString[] = "Trip A: ";
+  m_display.textWrite(tripAString);
+  m_display.textSetCursor(50, 225);
+  char tripBString[] = "Trip B: ";
+  m_display.textWrite(tripBString);
+  m_display.textSetCursor(50, 275);
+  char odometerString[] = "Odometer: ";
+  m_display.textWrite(odometerString);
+
+  m_display.textEnlarge(0);
+  m_display.textSetCursor(50, 330);
+  char resetString[] = "Tap a trip meter to reset it";
+  m_display.textWrite(resetString);
+}
+
+void Dashboard::updateTripDisplay() {
+  Serial.println("Updating trip display");
+  unsigned long tripSeconds = (millis() - m_tripStartTime) / 1000;
+  prevTripSeconds = tripSeconds;
+
+  //format trip time as h:mm:ss
+  char tripTimeString[12];
+  ultoa(tripSeconds / 3600, tripTimeString, 10);
+  uint8_t length = strlen(tripTimeString);
+  uint8_t minutes = tripSeconds / 60 % 60;
+  uint8_t seconds = tripSeconds % 60;
+  tripTimeString[length++] = ':';
+  tripTimeString[length++] = '0' + minutes / 10;
+  tripTimeString[length++] = '0' + minutes % 10;
+  tripTimeString[length++] = ':';
+  tripTimeString[length++] = '0' + seconds / 10;
+  tripTimeString[length++] = '0' + seconds % 10;
+  tripTimeString[length] = '\0';
+
+  m_display.graphicsMode();
+  m_display.fillRect(230, 75, 200, 32, RA8875_WHITE);
+  m_display.textMode();
+  m_display.textTransparent(RA8875_BLACK);
+  m_display.textEnlarge(1);
+  m_display.textSetCursor(230, 75);
+  m_display.textWrite(tripTimeString);
+
+  writeNumber(230, 125, 120, m_tripMaxSpeed);
+  writeDistance(230, 175, m_odometer.tripPulses(0));
+  writeDistance(230, 225, m_odometer.tripPulses(1));
+  writeDistance(230, 275, m_odometer.totalPulses());
+}
+
+void Dashboard::drawDiagnosticsDisplay() {
+  Serial.println("Drawing diagnostics display");
+  m_display.textMode();
+  m_display.textTransparent(RA8875_BLACK);
+  m_display.textEnlarge(1);
+  m_display.textSetCursor(50, 75);
+  char refVoltageString[] = "Reference:       mV";
+  m_display.textWrite(refVoltageString);
+  m_display.textSetCursor(50, 125);
+  char batteryVoltageString[] = "Battery:         mV";
+  m_display.textWrite(batteryVoltageString);
+  m_display.textSetCursor(50, 175);
+  char loopTimeString[] = "Loop time:       ms";
+  m_display.textWrite(loopTimeString);
+  m_display.textSetCursor(50, 225);
+  char touchesString[] = "Touches: ";
+  m_display.textWrite(touchesString);
+  m_display.textSetCursor(50, 275);
+  char packetsString[] = "Packets: ";
+  m_display.textWrite(packetsString);
+  m_display.textSetCursor(50, 325);
+  char crcErrorsString[] = "CRC errors: ";
+  m_display.textWrite(crcErrorsString);
+  m_display.textSetCursor(365, 75);
+  char overrunsString[] = "Overruns:";
+  m_display.textWrite(overrunsString);
+  m_display.textSetCursor(365, 125);
+  char slowestTaskString[] = "Slowest:";
+  m_display.textWrite(slowestTaskString);
+  m_display.textSetCursor(365, 175);
+  char worstOverrunString[] = "Worst ms:";
+  m_display.textWrite(worstOverrunString);
+  m_display.textSetCursor(365, 225);
+  char watchdogResetsString[] = "Resets:";
+  m_display.textWrite(watchdogResetsString);
+  m_display.textSetCursor(365, 275);
+  char droppedBytesString[] = "Dropped:";
+  m_display.textWrite(droppedBytesString);
+}
+
+void Dashboard::updateDiagnosticsDisplay() {
+  Serial.println("Updating diagnostics display");
+  prevDiagnosticsUpdateTime = millis();
+  writeNumber(230, 75, 80, m_refVoltage);
+  writeNumber(230, 125, 80, m_batteryVoltage);
+  writeNumber(230, 175, 80, loopTime);
+  writeNumber(230, 225, 100, touchEventCount);
+  writeNumber(230, 275, 100, m_telemetry.packetCount());
+  writeNumber(230, 325, 100, m_telemetry.crcErrors());
+  uint8_t slowestTask = m_monitor.worstTask();
+  writeNumber(509, 75, 66, m_monitor.totalOverruns());
+  writeNumber(509, 125, 66, slowestTask);
+  writeNumber(509, 175, 66, m_monitor.worstOverrun(slowestTask));
+  writeNumber(509, 225, 66, m_monitor.watchdogResets());
+  writeNumber(509, 275, 66, Telemetry::overruns());
+}
+
+void Dashboard::drawPerformanceDisplay() {
+  Serial.println("Drawing performance display");
+  m_display.textMode();
+  m_display.textTransparent(RA8875_BLACK);
+  m_display.textEnlarge(1);
+  m_display.textSetCursor(50, 75);
+  char speedString[] = "Speed:           mph";
+  m_display.textWrite(speedString);
+  m_display.textSetCursor(50, 115);
+  char accelerationString[] = "Accel:           mph/s";
+  m_display.textWrite(accelerationString);
+  m_display.textSetCursor(50, 155);
+  char stateString[] = "Run: ";
+  m_display.textWrite(stateString);
+  m_display.textSetCursor(365, 155);
+  char droppedPulsesString[] = "Dropped:";
+  m_display.textWrite(droppedPulsesString);
+  m_display.textSetCursor(50, 240);
+  char lowSpeedString[] = "0-30 mph:";
+  m_display.textWrite(lowSpeedString);
+  m_display.textSetCursor(50, 285);
+  char highSpeedString[] = "0-60 mph:";
+  m_display.textWrite(highSpeedString);
+  m_display.textSetCursor(50, 330);
+  char quarterMileString[] = "1/4 mile:";
+  m_display.textWrite(quarterMileString);
+
+  m_display.textEnlarge(0);
+  m_display.textSetCursor(230, 215);
+  char lastRunString[] = "Last run (s)";
+  m_display.textWrite(lastRunString);
+  m_display.textSetCursor(380, 215);
+  char bestRunString[] = "Best (tap to clear)";
+  m_display.textWrite(bestRunString);
+}
+
+void Dashboard::updatePerformanceDisplay() {
+  prevPerformanceUpdateTime = millis();
+  writeDecimal(230, 75, 90, m_performanceTimer.speed(), 1);
+  writeDecimal(230, 115, 90, m_performanceTimer.acceleration(), 1);
+}
+
+void Dashboard::updatePerformanceRunDisplay() {
+  Serial.println("Updating performance run display");
+  prevPerformanceState = m_performanceTimer.state();
+  switch (prevPerformanceState) {
+    case PERFORMANCE_WAITING: writeText(140, 155, 200, "Stop first"); break;
+    case PERFORMANCE_READY: writeText(140, 155, 200, "Ready"); break;
+    case PERFORMANCE_RUNNING: writeText(140, 155, 200, "Running"); break;
+    default: break;
+  }
+  //a run is aborted when pulses are dropped, which also changes the state
+  writeNumber(509, 155, 66, PerformanceTimer::overruns());
+
+  const PerformanceRecord& lastRun = m_performanceTimer.lastRun();
+  writeRunTime(230, 240, lastRun.lowSpeedTime);
+  writeRunTime(230, 285, lastRun.highSpeedTime);
+  writeRunTime(230, 330, lastRun.quarterMileTime);
+  const PerformanceRecord& bestRun = m_performanceTimer.bestRun();
+  writeRunTime(380, 240, bestRun.lowSpeedTime);
+  writeRunTime(380, 285, bestRun.highSpeedTime);
+  writeRunTime(380, 330, bestRun.quarterMileTime);
+}
+
+void Dashboard::updateCharts(unsigned long currentTime) {
+  if (!isCharging() || currentTime - prevChartSampleTime < CHART_SAMPLE_INTERVAL_MS) {
+    return;
+  }
+  Serial.println("Updating charts");
+  prevChartSampleTime = currentTime;
+
+  //keep recording on other pages so the history is complete when the charging page is shown again
+  m_batteryVoltageChart.addSample(m_batteryVoltage);
+  m_batteryTemperatureChart.addSample(m_batteryTemperature);
+  m_batteryCurrentChart.addSample(m_batteryCurrent);
+  if (m_page == CHARGING_PAGE) {
+    m_batteryVoltageChart.drawNewestSample(m_display);
+    m_batteryTemperatureChart.drawNewestSample(m_display);
+    m_batteryCurrentChart.drawNewestSample(m_display);
+  }
+}
+
+void Dashboard::updateChargeSession(unsigned long currentTime) {
+  if (!isCharging() || currentTime - prevChargeSampleTime < CHARGE_SAMPLE_INTERVAL_MS) {
+    return;
+  }
+  prevChargeSampleTime = currentTime;
+  m_chargeSession.addSample(currentTime, m_batteryVoltage, m_preciseBatteryCurrent, m_batteryPercentage);
+}
+
+void Dashboard::drawChargeEstimateDisplay() {
+  Serial.println("Drawing charge estimate display");
+  m_display.textMode();
+  m_display.textTransparent(RA8875_BLACK);
+  m_display.textEnlarge(1);
+  m_display.textSetCursor(50, CHARGE_ESTIMATE_Y);
+  char fullString[] = "Full in: ";
+  m_display.textWrite(fullString);
+  m_display.textSetCursor(300, CHARGE_ESTIMATE_Y);
+  char energyString[] = "Energy: ";
+  m_display.textWrite(energyString);
+  m_display.textSetCursor(500, CHARGE_ESTIMATE_Y);
+  char wattHoursString[] = "Wh";
+  m_display.textWrite(wattHoursString);
+}
+
+void Dashboard::updateChargeEstimateDisplay() {
+  Serial.println("Updating charge estimate display");
+  prevChargeEstimateTime = millis();
+  prevMinutesToFull = m_chargeSession.minutesToFull();
+  prevChargeEnergy = m_chargeSession.energy();
+
+  //format time to full as h:mm
+  char timeString[8];
+  if (prevMinutesToFull == CHARGE_UNKNOWN_TIME) {
+    strcpy(timeString, "-:--");
+  }
+  else {
+    utoa(prevMinutesToFull / 60, timeString, 10);
+    uint8_t length = strlen(timeString);
+    uint8_t minutes = prevMinutesToFull % 60;
+    timeString[length++] = ':';
+    timeString[length++] = '0' + minutes / 10;
+    timeString[length++] = '0' + minutes % 10;
+    timeString[length] = '\0';
+  }
+
+  m_display.graphicsMode();
+  m_display.fillRect(200, CHARGE_ESTIMATE_Y, 90, 32, RA8875_WHITE);
+  m_display.textMode();
+  m_display.textTransparent(RA8875_BLACK);
+  m_display.textEnlarge(1);
+  m_display.textSetCursor(200, CHARGE_ESTIMATE_Y);
+  m_display.textWrite(timeString);
+
+  writeNumber(430, CHARGE_ESTIMATE_Y, 68, prevChargeEnergy / 1000);
+}
+
+void Dashboard::writeNumber(uint16_t x, uint16_t y, uint16_t width, long value) {
+  //clear previous number
+  m_display.graphicsMode();
+  m_display.fillRect(x, y, width, 32, RA8875_WHITE);
+
+  m_display.textMode();
+  m_display.textTransparent(RA8875_BLACK);
+  m_display.textEnlarge(1);
+  m_display.textSetCursor(x, y);
+  char numberString[12];
+  m_display.textWrite(ltoa(value, numberString, 10));
+}
+
+void Dashboard::writeText(uint16_t x, uint16_t y, uint16_t width, const char* text) {
+  //clear previous text
+  m_display.graphicsMode();
+  m_display.fillRect(x, y, width, 32, RA8875_WHITE);
+
+  m_display.textMode();
+  m_display.textTransparent(RA8875_BLACK);
+  m_display.textEnlarge(1);
+  m_display.textSetCursor(x, y);
+  m_display.textWrite(text);
+}
+
+void Dashboard::writeDecimal(uint16_t x, uint16_t y, uint16_t width, long value, uint8_t decimals) {
+  char numberString[16];
+  uint8_t length = 0;
+  if (value < 0) {
+    numberString[length++] = '-';
+    value = -value;
+  }
+
+  //split the value into the whole part and the decimals
+  unsigned long scale = 1;
+  for (uint8_t i = 0; i < decimals; ++i) {
+    scale *= 10;
+  }
+  ultoa(value / scale, numberString + length, 10);
+  length = strlen(numberString);
+  if (decimals > 0) {
+    numberString[length++] = '.';
+    unsigned long fraction = value % scale;
+    for (uint8_t i = 0; i < decimals; ++i) {
+      scale /= 10;
+      numberString[length++] = '0' + fraction / scale % 10;
+    }
+  }
+  numberString[length] = '\0';
+
+  writeText(x, y, width, numberString);
+}
+
+void Dashboard::writeRunTime(uint16_t x, uint16_t y, uint16_t time) {
+  if (time == PERFORMANCE_NO_TIME) {
+    writeText(x, y, 140, "-");
+  }
+  else {
+    writeDecimal(x, y, 140, (time + 5UL) / 10, 2);
+  }
+}
+
+void Dashboard::writeDistance(uint16_t x, uint16_t y, uint32_t pulses) {
+  //convert wheel pulses to tenths of a mile
+  uint32_t tenthsOfMile = (uint64_t)pulses * TENTHS_OF_MILE_PER_PULSE_Q24 >> 24;
+
+  char distanceString[16];
+  ultoa(tenthsOfMile / 10, distanceString, 10);
+  uint8_t length = strlen(distanceString);
+  distanceString[length++] = '.';
+  distanceString[length++] = '0' + tenthsOfMile % 10;
+  distanceString[length++] = ' ';
+  distanceString[length++] = 'm';
+  distanceString[length++] = 'i';
+  distanceString[length] = '\0';
+
+  //clear previous distance
+  m_display.graphicsMode();
+  m_display.fillRect(x, y, 300, 32, RA8875_WHITE);
+
+  m_display.textMode();
+  m_display.textTransparent(RA8875_BLACK);
+  m_display.textEnlarge(1);
+  m_display.textSetCursor(x, y);
+  m_display.textWrite(distanceString);
+}
+
+void Dashboard::updateTouchEvents() {
+  //nothing to do unless the interrupt queued a touch
+  while (touchEventTail != touchEventHead) {
+    unsigned long eventTime = touchEventTimes[touchEventTail];
+    touchEventTail = (touchEventTail + 1) & (TOUCH_QUEUE_SIZE - 1);
+
+    //reading the coordinates also clears the touch controller's interrupt
+    uint16_t touchX;
+    uint16_t touchY;
+    m_display.touchRead(&touchX, &touchY);
+
+    //a finger held down keeps interrupting, only handle the first touch
+    bool isNewTouch = eventTime - prevTouchEventTime >= TOUCH_DEBOUNCE_MS;
+    prevTouchEventTime = eventTime;
+    if (!isNewTouch) {
+      continue;
+    }
+
+    ++touchEventCount;
+    //scale touch controller coordinates to the 800x480 screen
+    handleTouch((uint32_t)touchX * 800 / TOUCH_RAW_RANGE, (uint32_t)touchY * 480 / TOUCH_RAW_RANGE);
+  }
+}
+
+void Dashboard::handleTouch(uint16_t x, uint16_t y) {
+  Serial.println("Handling touch");
+
+  //switch pages with the tabs
+  if (y >= PAGE_TAB_Y) {
+    uint8_t page = x / PAGE_TAB_WIDTH;
+    if (page < PAGE_COUNT && page != m_page) {
+      showPage(page);
+    }
+    return;
+  }
+
+  //tapping a row of the trip page resets it
+  if (m_page == TRIP_PAGE && x < PAGE_AREA_WIDTH) {
+    if (y < 165) {
+      resetTrip();
+    }
+    else if (y < 215) {
+      m_odometer.resetTrip(0);
+    }
+    else if (y < 265) {
+      m_odometer.resetTrip(1);
+    }
+    else {
+      //the odometer can't be reset
+      return;
+    }
+    updateTripDisplay();
+  }
+
+  //tapping the best times of the performance page twice clears them
+  if (m_page == PERFORMANCE_PAGE && x >= 380 && x < PAGE_AREA_WIDTH && y >= 240 && y < PAGE_AREA_HEIGHT) {
+    if (isClearBestRunPending && millis() - prevClearBestRunTapTime < PERFORMANCE_CLEAR_CONFIRM_MS) {
+      isClearBestRunPending = false;
+      m_performanceTimer.clearBestRun();
+      updatePerformanceRunDisplay();
+    }
+    else {
+      isClearBestRunPending = true;
+      prevClearBestRunTapTime = millis();
+      writeText(140, 155, 200, "Tap again");
+    }
+  }
+}
+
+void Dashboard::resetTrip() {
+  Serial.println("Resetting trip");
+  m_tripStartTime = millis();
+  m_tripMaxSpeed = 0;
+}
+
 void Dashboard::updateLowBatteryDisplay() {
   //TODO: de-couple the check for warning and the display of the warning
   Serial.println("Checking for low battery");
-  if (m_batteryPercentage <= LOW_BATT_THRESHOLD) {
+  if (m_batteryPercentage <= BatteryPack::lowBatteryThreshold) {
     Serial.println("Low Battery!");
     m_warnings[LOW_BATTERY] = true;
     m_display.textMode();
@@ -385,7 +1128,7 @@ void Dashboard::updateLowBatteryDisplay() {
 void Dashboard::updateBatteryOverheatDisplay() {
   //TODO: de-couple the check for warning and the display of the warning
   Serial.println("Checking for battery overheat");
-  if (m_batteryTemperature > BATT_OVERHEAT_THRESHOLD) {
+  if (m_batteryTemperature > BatteryPack::overheatThreshold) {
     Serial.println("Baterry Overheat!");
     m_warnings[BATTERY_OVERHEAT] = true;
     m_display.textMode();
@@ -408,7 +1151,7 @@ void Dashboard::updateBatteryOverheatDisplay() {
 void Dashboard::updateBatteryLowTemperatureDisplay() {
   //TODO: de-couple the check for warning and the display of the warning
   Serial.println("Checking for low battery temperature");
-  if (m_batteryTemperature < BATT_LOW_TEMP_THRESHOLD) {
+  if (m_batteryTemperature < BatteryPack::lowTempThreshold) {
     Serial.println("Low Battery Temperature!");
     m_warnings[BATTERY_LOW_TEMPERATURE] = true;
     m_display.textMode();
@@ -429,7 +1172,39 @@ void Dashboard::updateBatteryLowTemperatureDisplay() {
 }
 
 void Dashboard::updateBatteryImbalanceDisplay() {
-  //TODO: implement the function to check for imbalanced charging
+  //TODO: de-couple the check for warning and the display of the warning
+  Serial.println("Checking for battery imbalance");
+
+  //cell voltages are only known from the BMS telemetry
+  bool isImbalanced = false;
+  if (isBmsTelemetryFresh() && m_cellCount > 1) {
+    uint16_t minCellVoltage = m_cellVoltages[0];
+    uint16_t maxCellVoltage = m_cellVoltages[0];
+    for (uint8_t cell = 1; cell < m_cellCount; ++cell) {
+      minCellVoltage = min(minCellVoltage, m_cellVoltages[cell]);
+      maxCellVoltage = max(maxCellVoltage, m_cellVoltages[cell]);
+    }
+    isImbalanced = maxCellVoltage - minCellVoltage > BatteryPack::imbalanceThreshold;
+  }
+
+  if (isImbalanced) {
+    Serial.println("Battery Imbalance!");
+    m_warnings[BATTERY_IMBALANCE] = true;
+    m_display.textMode();
+    m_display.textTransparent(RA8875_RED);
+    m_display.textEnlarge(0);
+    char batteryImbalanceString[] = "Battery Imbalance";
+    m_display.textSetCursor(590, 235);
+    m_display.textWrite(batteryImbalanceString);
+  }
+  else {
+    //remove warning if the cells are balanced again
+    if (m_warnings[BATTERY_IMBALANCE]) {
+      m_warnings[BATTERY_IMBALANCE] = false;
+      m_display.graphicsMode();
+      m_display.fillRect(590, 235, 150, 20, RA8875_WHITE);
+    }
+  }
 }
 
 void Dashboard::updateBatteryVoltage() {
@@ -438,6 +1213,151 @@ void Dashboard::updateBatteryVoltage() {
   m_batteryVoltage = battery.voltage() * BATT_MULTIPLIER;
 }
 
+void Dashboard::startReferenceMeasurement() {
+  if (isMeasuringVcc || millis() - prevVccMeasurementTime < VCC_MEASURE_INTERVAL_MS) {
+    return;
+  }
+
+  //select the bandgap with Vcc as the reference, the same reference analogRead() uses
+#ifdef MUX5
+  ADCSRB &= ~_BV(MUX5);
+#endif
+  ADMUX = _BV(REFS0) | BANDGAP_MUX;
+  vccMeasurementStartTime = micros();
+  isMeasuringVcc = true;
+}
+
+void Dashboard::finishReferenceMeasurement() {
+  if (!isMeasuringVcc) {
+    return;
+  }
+  isMeasuringVcc = false;
+
+  //try again in the next loop if the loop was too short for the bandgap to settle
+  //or if an analogRead() switched the channel in the meantime
+  bool isBandgapSelected = ADMUX == (_BV(REFS0) | BANDGAP_MUX);
+#ifdef MUX5
+  isBandgapSelected = isBandgapSelected && !(ADCSRB & _BV(MUX5));
+#endif
+  if (!isBandgapSelected || micros() - vccMeasurementStartTime < BANDGAP_SETTLE_US) {
+    return;
+  }
+
+  //a single conversion only takes ~100us
+  ADCSRA |= _BV(ADSC);
+  while (ADCSRA & _BV(ADSC));
+  uint16_t reading = ADC;
+  prevVccMeasurementTime = millis();
+  if (reading == 0) {
+    return;
+  }
+
+  uint16_t vcc = vccCalibration / reading;
+  if (vcc < MIN_VCC || vcc > MAX_VCC) {
+    Serial.println("Reference voltage out of range!");
+    return;
+  }
+  //smooth out noise in the measurement
+  m_refVoltage = ((uint32_t)m_refVoltage * 3 + vcc) / 4;
+
+  //only restart the battery library when the reference has actually moved
+  if (abs((int16_t)(m_refVoltage - batteryRefVoltage)) >= VCC_BATTERY_UPDATE_THRESHOLD) {
+    battery.begin(m_refVoltage, BatteryPack::dividerRatio);
+    batteryRefVoltage = m_refVoltage;
+  }
+}
+
+uint16_t Dashboard::readCorrectedAnalog(uint8_t pin) {
+  uint32_t reading = (uint32_t)analogRead(pin) * m_refVoltage / NOMINAL_VCC;
+  return (reading > 1023) ? 1023 : reading;
+}
+
+void Dashboard::readTelemetry() {
+  //read each packet in place in the ring buffer
+  while (m_telemetry.nextPacket()) {
+    switch (m_telemetry.packetType()) {
+      case CONTROLLER_STATUS_PACKET: handleControllerStatusPacket(); break;
+      case BMS_STATUS_PACKET: handleBmsStatusPacket(); break;
+      case BMS_CELLS_PACKET: handleBmsCellsPacket(); break;
+      default: Serial.println("Unknown telemetry packet!"); break;
+    }
+    m_telemetry.consumePacket();
+  }
+}
+
+bool Dashboard::isControllerTelemetryFresh() {
+  return hasControllerPacket && millis() - controllerPacketTime < TELEMETRY_TIMEOUT_MS;
+}
+
+bool Dashboard::isBmsTelemetryFresh() {
+  return hasBmsPacket && millis() - bmsPacketTime < TELEMETRY_TIMEOUT_MS;
+}
+
+void Dashboard::handleControllerStatusPacket() {
+  if (m_telemetry.packetLength() < 6) {
+    Serial.println("Controller status packet too short!");
+    return;
+  }
+  hasControllerPacket = true;
+  controllerPacketTime = millis();
+
+  m_motorRpm = m_telemetry.readWord(0);
+  m_phaseCurrent = m_telemetry.readWord(2);
+  m_controllerTemperature = m_telemetry.readByte(4);
+  uint8_t faults = m_telemetry.readByte(5);
+  if (faults != m_controllerFaults) {
+    Serial.print("Controller faults: ");
+    Serial.println(faults, HEX);
+    m_controllerFaults = faults;
+  }
+
+  uint32_t speed = m_motorRpm * RPM_TO_MPH_Q16 >> 16;
+  m_speed = (speed > Vehicle::maxSpeed) ? Vehicle::maxSpeed : speed;
+  if (m_speed > m_tripMaxSpeed) {
+    m_tripMaxSpeed = m_speed;
+  }
+}
+
+void Dashboard::handleBmsStatusPacket() {
+  if (m_telemetry.packetLength() < 7) {
+    Serial.println("BMS status packet too short!");
+    return;
+  }
+  hasBmsPacket = true;
+  bmsPacketTime = millis();
+
+  m_batteryVoltage = m_telemetry.readWord(0);
+  //the BMS reports 0.1A, the dashboard shows whole amperes
+  m_preciseBatteryCurrent = m_telemetry.readWord(2);
+  int16_t current = m_preciseBatteryCurrent / 10;
+  m_batteryCurrent = constrain(current, (int16_t)-128, (int16_t)127);
+  m_batteryTemperature = m_telemetry.readByte(4);
+  uint8_t percentage = m_telemetry.readByte(5);
+  m_batteryPercentage = (percentage > 100) ? 100 : percentage;
+  uint8_t faults = m_telemetry.readByte(6);
+  if (faults != m_bmsFaults) {
+    Serial.print("BMS faults: ");
+    Serial.println(faults, HEX);
+    m_bmsFaults = faults;
+  }
+}
+
+void Dashboard::handleBmsCellsPacket() {
+  if (m_telemetry.packetLength() < 1) {
+    Serial.println("BMS cells packet too short!");
+    return;
+  }
+
+  uint8_t firstCell = m_telemetry.readByte(0);
+  uint8_t cellCount = (m_telemetry.packetLength() - 1) / 2;
+  for (uint8_t i = 0; i < cellCount && firstCell + i < TELEMETRY_MAX_CELLS; ++i) {
+    m_cellVoltages[firstCell + i] = m_telemetry.readWord(1 + i * 2);
+    if (firstCell + i >= m_cellCount) {
+      m_cellCount = firstCell + i + 1;
+    }
+  }
+}
+
 void Dashboard::drawBatteryVoltageDisplay() {
   Serial.println("Drawing battery voltage display");
 
@@ -469,20 +1389,20 @@ void Dashboard::updateBatteryVoltageDisplay() {
   m_display.textTransparent(RA8875_BLACK);
   m_display.textEnlarge(1);
   m_display.textSetCursor(270, 116);
-  char currentBatteryVoltageString[5];
-  m_display.textWrite(itoa(m_batteryVoltage, currentBatteryVoltageString, 10));
+  char currentBatteryVoltageString[6];
+  m_display.textWrite(utoa(m_batteryVoltage, currentBatteryVoltageString, 10));
 
   m_display.graphicsMode();
   //convert voltage into a percentage between minimum and maximum voltage
   uint8_t voltagePercentage;
-  if (m_batteryVoltage <= BATT_MIN_VOLTAGE) {
+  if (m_batteryVoltage <= BatteryPack::minVoltage) {
     voltagePercentage = 0;
   }
-  else if (m_batteryVoltage >= BATT_MAX_VOLTAGE) {
+  else if (m_batteryVoltage >= BatteryPack::maxVoltage) {
     voltagePercentage = 100;
   }
   else {
-    voltagePercentage = ((long)m_batteryVoltage - BATT_MIN_VOLTAGE) * 100 / (BATT_MAX_VOLTAGE - BATT_MIN_VOLTAGE);
+    voltagePercentage = (uint32_t)(m_batteryVoltage - BatteryPack::minVoltage) * VOLTAGE_PERCENT_SCALE_Q16 >> 16;
   }
   //fill in bar graph (multiply percentage value by 2 to scale)
   voltagePercentage *= 2;
@@ -525,7 +1445,7 @@ void Dashboard::updateBatteryTemperatureDisplay() {
   m_display.textTransparent(RA8875_BLACK);
   m_display.textEnlarge(1);
   m_display.textSetCursor(270, 191);
-  char currentBatteryTemperatureString[3];
+  char currentBatteryTemperatureString[5];
   m_display.textWrite(itoa(m_batteryTemperature, currentBatteryTemperatureString, 10));
 
   //clear bar graph
@@ -533,30 +1453,32 @@ void Dashboard::updateBatteryTemperatureDisplay() {
   m_display.fillRect(51, 196, 200, 23, RA8875_WHITE);
 
   int8_t temperature;
+  int16_t barWidth;
   uint16_t color = RA8875_GREEN;
-  if (m_batteryTemperature <= BATT_MIN_TEMP) {
-    temperature = BATT_MIN_TEMP;
+  if (m_batteryTemperature <= BatteryPack::minTemp) {
+    temperature = BatteryPack::minTemp;
   }
-  else if (m_batteryTemperature >= BATT_MAX_TEMP) {
-    temperature = BATT_MAX_TEMP;
+  else if (m_batteryTemperature >= BatteryPack::maxTemp) {
+    temperature = BatteryPack::maxTemp;
   }
   else {
     temperature = m_batteryTemperature;
   }
   //change color to red if battery temperature is outside of operating range
-  if (temperature > BATT_OVERHEAT_THRESHOLD || temperature < BATT_LOW_TEMP_THRESHOLD) {
+  if (temperature > BatteryPack::overheatThreshold || temperature < BatteryPack::lowTempThreshold) {
     color = RA8875_RED;
   }
 
   //fill in bar graph
+  barWidth = (int16_t)temperature * TEMP_BAR_SCALE_Q8 >> 8;
   if (temperature < 0) {
-    if (temperature >= BATT_LOW_TEMP_THRESHOLD) {
+    if (temperature >= BatteryPack::lowTempThreshold) {
       color = RA8875_CYAN;
     }
-    m_display.fillRect(150 + temperature, 196, abs(temperature), 23, color);
+    m_display.fillRect(150 + barWidth, 196, abs(barWidth), 23, color);
   }
   else {
-    m_display.fillRect(151, 196, temperature, 23, color);
+    m_display.fillRect(151, 196, barWidth, 23, color);
   }
   //display line at 0 degree
   m_display.drawLine(150, 196, 150, 219, RA8875_BLACK);
@@ -592,23 +1514,24 @@ void Dashboard::updateBatteryCurrentDisplay() {
   m_display.textTransparent(RA8875_BLACK);
   m_display.textEnlarge(1);
   m_display.textSetCursor(270, 266);
-  char currentBatteryCurrentString[2];
+  char currentBatteryCurrentString[5];
   m_display.textWrite(itoa(m_batteryCurrent, currentBatteryCurrentString, 10));
 
   //clear bar graph
   m_display.graphicsMode();
   m_display.fillRect(51, 271, 200, 23, RA8875_WHITE);
 
-  int8_t current;
+  int16_t current;
   uint16_t color = RA8875_RED;
-  if (m_batteryCurrent <= BATT_MIN_CURRENT) {
-    current = BATT_MIN_CURRENT * 2; //multiply current by 2 to scale
+  //scale current to the bar's width
+  if (m_batteryCurrent <= BatteryPack::minCurrent) {
+    current = BatteryPack::minCurrent * CURRENT_BAR_SCALE_Q8 >> 8;
   }
-  else if (m_batteryCurrent >= BATT_MAX_CURRENT) {
-    current = BATT_MAX_CURRENT * 2;
+  else if (m_batteryCurrent >= BatteryPack::maxCurrent) {
+    current = BatteryPack::maxCurrent * CURRENT_BAR_SCALE_Q8 >> 8;
   }
   else {
-    current = m_batteryCurrent * 2;
+    current = m_batteryCurrent * CURRENT_BAR_SCALE_Q8 >> 8;
     color = RA8875_GREEN;
   }
 
@@ -706,6 +1629,18 @@ void Dashboard::updateLightsDisplay() {
 void Dashboard::updateSpeedDisplay() {
   Serial.println("Updating speed display");
   m_display.graphicsMode();
+#ifdef SPEED_GAUGE
+  updateSpeedGaugeDisplay();
+
+  //clear previous speed under the gauge's hub
+  m_display.fillRect(GAUGE_CENTER_X - 36, GAUGE_CENTER_Y + 30, 72, 48, RA8875_WHITE);
+  m_display.textMode();
+  char currentSpeed[4];
+  m_display.textSetCursor(GAUGE_CENTER_X - 36, GAUGE_CENTER_Y + 30);
+  m_display.textTransparent(RA8875_BLACK);
+  m_display.textEnlarge(2);
+  m_display.textWrite(itoa(m_speed, currentSpeed, 10));
+#else
   //clear previous speed
   m_display.fillRect(300, 200, 120, 60, RA8875_WHITE);
   m_display.textMode();
@@ -714,11 +1649,45 @@ void Dashboard::updateSpeedDisplay() {
   m_display.textTransparent(RA8875_BLACK);
   m_display.textEnlarge(3);
   m_display.textWrite(itoa(m_speed, currentSpeed, 10));
+#endif
+}
+
+void Dashboard::updateSpeedGaugeDisplay() {
+  Serial.println("Updating speed gauge display");
+  if (gaugeNeedleSpeed == m_speed) {
+    return;
+  }
+
+  //erase only the old needle instead of clearing the whole gauge
+  drawSpeedGaugeNeedle(gaugeNeedleSpeed, RA8875_WHITE);
+
+  //restore the tick marks on either side of the old needle, which are the only ones it can cover
+  uint8_t tickBelow = gaugeNeedleSpeed - gaugeNeedleSpeed % GAUGE_TICK_STEP;
+  drawSpeedGaugeTick(tickBelow);
+  if (tickBelow + GAUGE_TICK_STEP <= Vehicle::maxSpeed) {
+    drawSpeedGaugeTick(tickBelow + GAUGE_TICK_STEP);
+  }
+
+  //draw new needle and the hub over its base
+  drawSpeedGaugeNeedle(m_speed, RA8875_RED);
+  m_display.fillCircle(GAUGE_CENTER_X, GAUGE_CENTER_Y, GAUGE_HUB_RADIUS, RA8875_BLACK);
+  gaugeNeedleSpeed = m_speed;
+}
+
+void Dashboard::touchInterrupt() {
+  uint8_t nextHead = (touchEventHead + 1) & (TOUCH_QUEUE_SIZE - 1);
+  //drop the touch if the queue is full
+  if (nextHead != touchEventTail) {
+    touchEventTimes[touchEventHead] = millis();
+    touchEventHead = nextHead;
+  }
 }
 
 void Dashboard::countPulse() {
   currentSignalTime = micros();
   ++pulses;
+  //only recorded in performance mode
+  PerformanceTimer::recordPulse(currentSignalTime);
 }
 
 void Dashboard::reset() {
@@ -731,9 +1700,9 @@ void Dashboard::reset() {
   m_isRightOn = false;
   m_isLoOn = false;
   m_isHiOn = false;
-  m_refVoltage = 0;
   m_batteryVoltage = 0;
   m_batteryCurrent = 0;
+  m_preciseBatteryCurrent = 0;
   m_batteryPercentage = 0;
   m_batteryTemperature = 0;
   m_speed = 0;
@@ -13,14 +13,31 @@
 #include <Battery.h>
 #include <Adafruit_RA8875.h>
 #include <PinChangeInterrupt.h>
+#include "Profiles.h"
+#include "Odometer.h"
+#include "StripChart.h"
+#include "ChargeSession.h"
+#include "LoopMonitor.h"
+#include "PerformanceTimer.h"
+#include "Telemetry.h"
 
 //sets the storage area of the calibrated microcontroller voltage to the very end of the EEPROM
 #define VREF_EEPROM_ADDR (E2END - 2) 
-//voltage divider ratio for the sensing circuit
-#define DIVIDER_RATIO 4.0 
+static_assert(PERFORMANCE_EEPROM_END <= VREF_EEPROM_ADDR, "Odometer records, fault log and best run overlap the voltage reference calibration");
+//internal 1.1V reference in millivolts * 1024, used when the EEPROM has no calibration
+#define DEFAULT_VREF_CALIBRATION 1126400L
+//ADC multiplexer setting that selects the internal 1.1V bandgap reference
+#if defined(__AVR_ATmega2560__) || defined(__AVR_ATmega1280__)
+#define BANDGAP_MUX 0x1E
+#else
+#define BANDGAP_MUX 0x0E
+#endif
 //value of the voltage divider used for the battery feeding the arduino
 //multiply the voltage reading by this value to get the battery voltage
 #define BATT_MULTIPLIER 1 
+//shows an analog speedometer gauge around the speed readout
+//comment out to show only the numeric speed readout
+#define SPEED_GAUGE
 
 //list of analog sense pins
 #define BATT_VOLTAGE_SENSE_PIN A1 // pin for sensing battery voltage (analog A0)
@@ -35,6 +52,16 @@ enum Warnings {
   BATTERY_IMBALANCE,
 };
 
+//pages of the dashboard, selected with the tabs at the bottom of the touch screen
+enum Pages {
+  MAIN_PAGE,
+  CHARGING_PAGE,
+  TRIP_PAGE,
+  DIAGNOSTICS_PAGE,
+  PERFORMANCE_PAGE,
+  PAGE_COUNT,
+};
+
 //list of digital sense pins
 enum DigitalSensePins {
   LEFT_LIGHT_SENSE_PIN = 24,
@@ -43,25 +70,90 @@ enum DigitalSensePins {
   HI_LIGHT_SENSE_PIN = 30,
   SPEED_SENSE_PIN = 11,
   CHARGE_SENSE_PIN = 22,
+  //held high while the key is on, through a divider from the switched supply whose lower resistor pulls it low
+  //while the key is off, so the line is never left floating. The board must stay powered for about a loop
+  //and ODOMETER_POWER_SENSE_DEBOUNCE_MS after the key goes off to save the odometer
+  POWER_SENSE_PIN = 32,
 };
 
+//vehicle and battery specific constants are in the profiles, see Profiles.h
 enum Constants {
-  LOW_BATT_THRESHOLD = 20,
-  BATT_OVERHEAT_THRESHOLD = 60, //battery overheat threshold in degrees celsius
-  BATT_LOW_TEMP_THRESHOLD = -20, //battery low temperature threshold in degrees celsius
   //battery percentage error due to fluctuation in voltage 
   //this is to reduce flickering caused by constantly updating the battery percentage display
   BATT_PERCENT_ERROR = 2, 
-  BATT_MIN_TEMP = -100, //minimum temperature range for battery in celsius
-  BATT_MAX_TEMP = 100, //maximum temperature range for battery in celsius
-  BATT_MIN_VOLTAGE = 9000, //battery minimum voltage after voltage divider in millivolts
-  BATT_MAX_VOLTAGE = 12000, //battery maximum voltage after voltage divider in millivolts
-  BATT_MIN_CURRENT = -50, //battery minimum current in amperes
-  BATT_MAX_CURRENT = 50, //battery maximum current in amperes
-  WHEEL_DIAMETER_INCHES = 1, //diameter of the motorcycle's wheel in inches
-  MAX_SPEED = 120, //maximum speed in mph
 };
 
+//the analog sensors take over again when no telemetry has been received for this long. Packets are read at
+//the start of every task, so up to a whole task can pass between reads, allow twice the longest one
+constexpr uint16_t TELEMETRY_TIMEOUT_MS = 2 * longestTaskDeadline();
+
+//timing and limits of the background reference voltage measurement
+enum ReferenceVoltage {
+  VCC_MEASURE_INTERVAL_MS = 1000,
+  BANDGAP_SETTLE_US = 2000, //time the bandgap needs after being selected before it can be measured
+  NOMINAL_VCC = 5000, //reference voltage the analog sensor scaling assumes in millivolts
+  MIN_VCC = 4000, //measurements outside this range are ignored
+  MAX_VCC = 5500,
+  VCC_BATTERY_UPDATE_THRESHOLD = 10, //the battery library gets the new reference once it changes by this many millivolts
+};
+
+//layout of the analog speedometer gauge
+enum SpeedGauge {
+  GAUGE_CENTER_X = 280,
+  GAUGE_CENTER_Y = 220,
+  GAUGE_START_ANGLE = 210, //angle of the needle at 0 mph in degrees, counter-clockwise from 3 o'clock
+  GAUGE_SWEEP_ANGLE = 240, //angle the needle sweeps between 0 mph and the vehicle's maximum speed in degrees
+  GAUGE_TICK_STEP = 10, //speed between tick marks in mph
+  GAUGE_LABEL_STEP = 20, //speed between labelled (major) tick marks in mph
+  GAUGE_TICK_OUTER_RADIUS = 150,
+  GAUGE_TICK_INNER_RADIUS = 138,
+  GAUGE_MAJOR_TICK_INNER_RADIUS = 126,
+  GAUGE_LABEL_RADIUS = 168,
+  //the needle reaches into the tick marks, so they have to be restored when the needle moves away
+  GAUGE_NEEDLE_LENGTH = 145,
+  GAUGE_NEEDLE_HALF_WIDTH = 4,
+  GAUGE_HUB_RADIUS = 8,
+};
+
+//layout and timing of the touch screen input
+enum Touch {
+  PAGE_AREA_WIDTH = 575, //area that gets cleared when switching pages
+  PAGE_AREA_HEIGHT = 365,
+  PAGE_TAB_Y = 448,
+  PAGE_TAB_WIDTH = PAGE_AREA_WIDTH / PAGE_COUNT,
+  PAGE_TAB_HEIGHT = 30,
+  TOUCH_QUEUE_SIZE = 8, //must be a power of 2
+  TOUCH_DEBOUNCE_MS = 250, //touches closer together than this are treated as one, e.g. a finger held down
+  TOUCH_RAW_RANGE = 1024, //touch controller coordinates are 10 bits
+};
+
+//layout and timing of the charging page's history charts
+enum Charts {
+  CHART_X = 410,
+  BATT_VOLTAGE_CHART_Y = 80,
+  BATT_TEMP_CHART_Y = 155,
+  BATT_CURRENT_CHART_Y = 230,
+  //the charts show STRIP_CHART_WIDTH samples, 160 samples 5s apart is a bit over 13 minutes
+  CHART_SAMPLE_INTERVAL_MS = 5000,
+  //the charge session gets a raw sample every second and refreshes its estimate at most every 5s
+  CHARGE_SAMPLE_INTERVAL_MS = 1000,
+  CHARGE_ESTIMATE_INTERVAL_MS = 5000,
+  CHARGE_ESTIMATE_Y = 310,
+};
+
+//refresh interval of the performance page's speed and acceleration
+#define PERFORMANCE_DISPLAY_INTERVAL_MS 250
+//the best times are only cleared by a second tap within this long of the first
+#define PERFORMANCE_CLEAR_CONFIRM_MS 3000
+
+/*
+  Returns the angle of the gauge needle in degrees for a given speed
+  @param speed is the speed in mph, between 0 and the vehicle's maximum speed
+*/
+constexpr int16_t speedToGaugeAngle(uint8_t speed) {
+  return GAUGE_START_ANGLE - (int16_t)speed * GAUGE_SWEEP_ANGLE / Vehicle::maxSpeed;
+}
+
 class Dashboard {
 
   private:
@@ -71,9 +163,35 @@ class Dashboard {
     uint16_t m_refVoltage; //board's reference voltage ~5V
     uint16_t m_batteryVoltage; //battery voltage in millivolts
     int8_t m_batteryCurrent; //battery current in amperes
+    int16_t m_preciseBatteryCurrent; //battery current in 0.1A, the charge session needs more than whole amperes
     uint8_t m_batteryPercentage;
     int8_t m_batteryTemperature; //battery temperature in degrees Celsius
     uint8_t m_speed; //speed of the motorcycle in mph
+    uint8_t m_touchInterruptPin;
+    uint8_t m_page; //page currently shown, one of Pages
+
+    //trip counters, reset by tapping the trip page
+    unsigned long m_tripStartTime; //time the trip was reset in milliseconds
+    uint8_t m_tripMaxSpeed; //maximum speed during the trip in mph
+    Odometer m_odometer; //odometer and trip meters A & B
+
+    //history charts of the charging page, recorded while charging
+    StripChart m_batteryVoltageChart;
+    StripChart m_batteryTemperatureChart;
+    StripChart m_batteryCurrentChart;
+    ChargeSession m_chargeSession;
+    LoopMonitor m_monitor;
+    PerformanceTimer m_performanceTimer;
+
+    //values received from the motor controller and the BMS, the BMS also updates the battery values above
+    Telemetry m_telemetry;
+    uint16_t m_motorRpm;
+    int16_t m_phaseCurrent; //motor phase current in 0.1A
+    int8_t m_controllerTemperature; //controller temperature in degrees Celsius
+    uint8_t m_controllerFaults;
+    uint8_t m_bmsFaults;
+    uint16_t m_cellVoltages[TELEMETRY_MAX_CELLS]; //cell voltages in millivolts
+    uint8_t m_cellCount;
 
     //bool m_isBalanced;
     //TODO: Have an array to store the voltages and temperatures of different cells to measure imbalance while charging
@@ -86,6 +204,13 @@ class Dashboard {
 
     //General purpose functions
     void initDashboard();
+    /*
+      Switches to another page, only redrawing the page area and the tabs
+      @param page is the page to show, one of Pages
+    */
+    void showPage(uint8_t page);
+    void drawPage();
+    void resetTrip();
     /*
      * Resets all member variables except m_isCharging. Use when changing charging states
      */
@@ -93,6 +218,16 @@ class Dashboard {
 
     //Helper functions that draw elements onto the display
     void drawSpeedIndicator();
+    void drawSpeedGauge();
+    /*
+      @param speed is the speed in mph of the tick mark to draw
+    */
+    void drawSpeedGaugeTick(uint8_t speed);
+    /*
+      @param speed is the speed in mph the needle points to
+      @param color is the color of the needle, use the background color to erase it
+    */
+    void drawSpeedGaugeNeedle(uint8_t speed, uint16_t color);
     void drawBatteryOutline();
     void drawLightIndicators();
     void drawLeftLight();
@@ -103,6 +238,40 @@ class Dashboard {
     void drawBatteryVoltageDisplay();
     void drawBatteryTemperatureDisplay();
     void drawBatteryCurrentDisplay();
+    void drawPageTabs();
+    void drawTripDisplay();
+    void drawDiagnosticsDisplay();
+    void drawPerformanceDisplay();
+    /*
+      Clears a number field and writes a new value into it with large text
+      @param x, y are the position of the field
+      @param width is the width of the field in pixels
+      @param value is the number to write
+    */
+    void writeNumber(uint16_t x, uint16_t y, uint16_t width, long value);
+    /*
+      Clears a distance field and writes a new distance into it in miles with one decimal
+      @param x, y are the position of the field
+      @param pulses is the distance in wheel pulses
+    */
+    void writeDistance(uint16_t x, uint16_t y, uint32_t pulses);
+    /*
+      Clears a text field and writes new text into it with large text
+      @param x, y are the position of the field
+      @param width is the width of the field in pixels
+    */
+    void writeText(uint16_t x, uint16_t y, uint16_t width, const char* text);
+    /*
+      Clears a number field and writes a new value into it with a fixed number of decimals
+      @param value is the number to write, scaled up by 10 for every decimal
+      @param decimals is the number of decimals
+    */
+    void writeDecimal(uint16_t x, uint16_t y, uint16_t width, long value, uint8_t decimals);
+    /*
+      Clears a run time field and writes a time in seconds with two decimals, or a dash if it's not set
+      @param time is the run time in milliseconds
+    */
+    void writeRunTime(uint16_t x, uint16_t y, uint16_t time);
 
     //Helper functions to check for warnings
     void updateLowBatteryDisplay();
@@ -116,6 +285,33 @@ class Dashboard {
     */
     bool updateChargingState();
     void updateBatteryVoltage();
+    /*
+      Selects the bandgap so it can settle while the rest of the loop runs. Call after the loop's last analogRead()
+    */
+    void startReferenceMeasurement();
+    /*
+      Measures the settled bandgap and updates the reference voltage. Call before the loop's first analogRead()
+    */
+    void finishReferenceMeasurement();
+    /*
+      Returns analogRead() corrected for the measured reference voltage, scaled as if the reference was NOMINAL_VCC
+      @param pin is the analog pin to read
+    */
+    uint16_t readCorrectedAnalog(uint8_t pin);
+    /*
+      Return true while packets from the motor controller or the BMS keep arriving
+    */
+    bool isControllerTelemetryFresh();
+    bool isBmsTelemetryFresh();
+    /*
+      Handles every complete packet in the telemetry ring buffer, called at the start of every task so the
+      ring buffer doesn't fill up while the loop runs
+    */
+    void readTelemetry();
+    //Helper functions that update internal values from the current telemetry packet
+    void handleControllerStatusPacket();
+    void handleBmsStatusPacket();
+    void handleBmsCellsPacket();
     /*
       @param sensePin is the sense pin for the light that will get its state updated
     */
@@ -128,7 +324,38 @@ class Dashboard {
     void updateBatteryCurrentDisplay();
     void updateBatteryDisplay();
     void updateSpeedDisplay();
+    void updateSpeedGaugeDisplay();
     void updateLightsDisplay();
+    void updateTripDisplay();
+    void updateDiagnosticsDisplay();
+    void updatePerformanceDisplay();
+    void updatePerformanceRunDisplay();
+    /*
+      Records a sample in the charging history charts every CHART_SAMPLE_INTERVAL_MS while charging
+      @param currentTime is the current time in milliseconds
+    */
+    void updateCharts(unsigned long currentTime);
+    /*
+      Adds a sample to the charge session every CHARGE_SAMPLE_INTERVAL_MS while charging
+    */
+    void updateChargeSession(unsigned long currentTime);
+    /*
+      Helper functions that draw the time to full and the energy delivered on the charging page
+    */
+    void drawChargeEstimateDisplay();
+    void updateChargeEstimateDisplay();
+
+    //Helper functions for touch input
+    /*
+      Handles the touches queued by touchInterrupt(). Costs a single comparison when there are none
+    */
+    void updateTouchEvents();
+    /*
+      @param x, y are the screen coordinates of the touch
+    */
+    void handleTouch(uint16_t x, uint16_t y);
+    //Function to call when the touch controller interrupt happens to queue a touch event
+    static void touchInterrupt();
 
     //Function to call when the interrupt happens to count the number of revolutions the wheel has made
     static void countPulse();
@@ -139,8 +366,9 @@ class Dashboard {
     /*
       Creates an instance of the dashboard that displays critical values and warnings for the motorcycle
       @param tft is the display object that is used for the dashboard
+      @param touchInterruptPin is the pin connected to the display's interrupt output
     */
-    Dashboard(Adafruit_RA8875 tft);
+    Dashboard(Adafruit_RA8875 tft, uint8_t touchInterruptPin);
     void begin();
     void updateDashboardDisplay();
     void updateWarningsDisplay();
@@ -148,6 +376,22 @@ class Dashboard {
     void updateBatteryPercentage();
     void updateBatteryCurrent();
     void updateSpeed();
+    void updateOdometer();
+    /*
+      Updates the values received from the motor controller and the BMS. Call after the other updates,
+      the analog sensing only takes over while there's no telemetry
+    */
+    void updateTelemetry();
+    /*
+      Starts the next task of the loop, which is checked against its deadline, and reads the telemetry received
+      during the previous task
+      @param task is one of LoopTasks
+    */
+    void startTask(uint8_t task);
+    /*
+      Saves the state that survives a watchdog reset, and prints the loop monitor's report when requested over serial
+    */
+    void updateMonitor();
     void updateLightStates();
 };
 
@@ -9,7 +9,7 @@
 //create display object
 Adafruit_RA8875 tft(RA8875_CS, RA8875_RESET);
 
-Dashboard dashboard = Dashboard(tft);
+Dashboard dashboard = Dashboard(tft, RA8875_INT);
 
 void setup() {
   Serial.begin(9600);
@@ -20,23 +20,42 @@ void setup() {
 
 void loop() {
   //update battery percentage
+  dashboard.startTask(BATTERY_PERCENTAGE_TASK);
   dashboard.updateBatteryPercentage();
 
   //update battery temperature
+  dashboard.startTask(BATTERY_TEMPERATURE_TASK);
   dashboard.updateBatteryTemperature();
 
   //update battery current
+  dashboard.startTask(BATTERY_CURRENT_TASK);
   dashboard.updateBatteryCurrent();
   
   //update light states
+  dashboard.startTask(LIGHT_STATES_TASK);
   dashboard.updateLightStates();
 
   //update speed
+  dashboard.startTask(SPEED_TASK);
   dashboard.updateSpeed();
 
+  //update odometer
+  dashboard.startTask(ODOMETER_TASK);
+  dashboard.updateOdometer();
+
+  //update values received from the motor controller and BMS
+  dashboard.startTask(TELEMETRY_TASK);
+  dashboard.updateTelemetry();
+
   //update warnings
+  dashboard.startTask(WARNINGS_TASK);
   dashboard.updateWarningsDisplay();
 
   //update dashboard visuals
+  dashboard.startTask(DISPLAY_TASK);
   dashboard.updateDashboardDisplay();
+
+  //save state for a watchdog reset, print the loop monitor's report on request
+  dashboard.startTask(MONITOR_TASK);
+  dashboard.updateMonitor();
 }
@@ -0,0 +1,69 @@
+/*
+  Fixed-point trigonometry for drawing on the display. Angles are in whole degrees and results are
+  scaled by 2^FIXED_TRIG_SHIFT, so drawing rotated elements doesn't need any floating point math.
+*/
+
+#ifndef FIXED_TRIG_H
+#define FIXED_TRIG_H
+
+#include <Arduino.h>
+
+//sine and cosine values are scaled by 2^14 (16384 = 1.0)
+#define FIXED_TRIG_SHIFT 14
+
+//quarter wave sine table, sin(0-90 degrees) * 2^14, stored in flash
+constexpr int16_t SIN_TABLE_Q14[91] PROGMEM = {
+  0, 286, 572, 857, 1143, 1428, 1713, 1997, 2280, 2563,
+  2845, 3126, 3406, 3686, 3964, 4240, 4516, 4790, 5063, 5334,
+  5604, 5872, 6138, 6402, 6664, 6924, 7182, 7438, 7692, 7943,
+  8192, 8438, 8682, 8923, 9162, 9397, 9630, 9860, 10087, 10311,
+  10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365,
+  12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044,
+  14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296,
+  15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083,
+  16135, 16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382,
+  16384,
+};
+
+/*
+  Returns sin(degrees) * 2^14
+  @param degrees is the angle in degrees, any value is accepted
+*/
+inline int16_t fixedSin(int16_t degrees) {
+  //wrap the angle into 0-359 degrees
+  degrees %= 360;
+  if (degrees < 0) {
+    degrees += 360;
+  }
+
+  //fold the angle into the first quadrant of the table
+  if (degrees <= 90) {
+    return pgm_read_word(&SIN_TABLE_Q14[degrees]);
+  }
+  else if (degrees <= 180) {
+    return pgm_read_word(&SIN_TABLE_Q14[180 - degrees]);
+  }
+  else if (degrees <= 270) {
+    return -(int16_t)pgm_read_word(&SIN_TABLE_Q14[degrees - 180]);
+  }
+  return -(int16_t)pgm_read_word(&SIN_TABLE_Q14[360 - degrees]);
+}
+
+/*
+  Returns cos(degrees) * 2^14
+  @param degrees is the angle in degrees, any value is accepted
+*/
+inline int16_t fixedCos(int16_t degrees) {
+  return fixedSin(degrees + 90);
+}
+
+/*
+  Scales a length by a fixed-point sine or cosine value, rounded to the nearest pixel
+  @param length is the length in pixels
+  @param trigValue is a value returned by fixedSin() or fixedCos()
+*/
+inline int16_t fixedScale(int16_t length, int16_t trigValue) {
+  return ((int32_t)length * trigValue + (1L << (FIXED_TRIG_SHIFT - 1))) >> FIXED_TRIG_SHIFT;
+}
+
+#endif
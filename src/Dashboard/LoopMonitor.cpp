@@ -0,0 +1,229 @@
+#include "LoopMonitor.h"
+#include <stddef.h>
+#include "Crc8.h"
+
+//kept across a reset, the startup code doesn't clear the .noinit section
+MonitorSnapshot monitorSnapshot __attribute__((section(".noinit")));
+volatile uint8_t monitorTask __attribute__((section(".noinit")));
+//set by the watchdog's interrupt, along with the task that hung
+volatile uint16_t watchdogMagic __attribute__((section(".noinit")));
+volatile uint8_t watchdogTask __attribute__((section(".noinit")));
+
+/*
+   Runs before the startup code, the watchdog stays on at its shortest timeout after a watchdog reset
+   and would reset again before setup() is reached
+*/
+void disableWatchdogAtBoot() __attribute__((naked, used, section(".init3")));
+void disableWatchdogAtBoot() {
+  MCUSR = 0;
+  wdt_disable();
+}
+
+/*
+   Constructor
+*/
+LoopMonitor::LoopMonitor()
+  : m_task(SETUP_TASK), m_taskStartTime(0), m_overruns{0}, m_worstOverruns{0}
+  , m_prevFaultLogTime(0), m_hasLoggedOverrun(false)
+{
+}
+
+void LoopMonitor::begin() {
+  //RAM has random contents after a power cycle, start a new snapshot
+  if (monitorSnapshot.magic != MONITOR_SNAPSHOT_MAGIC || monitorSnapshot.checksum != checksum(monitorSnapshot)) {
+    Serial.println("Starting new monitor snapshot");
+    memset(&monitorSnapshot, 0, sizeof(MonitorSnapshot));
+    monitorSnapshot.magic = MONITOR_SNAPSHOT_MAGIC;
+    watchdogMagic = 0;
+  }
+
+  if (watchdogMagic == MONITOR_SNAPSHOT_MAGIC) {
+    Serial.println("Reset by the watchdog");
+    watchdogMagic = 0;
+    if (monitorSnapshot.watchdogResets < 0xFF) {
+      ++monitorSnapshot.watchdogResets;
+    }
+    recordFault(watchdogTask, FAULT_WATCHDOG_RESET, 0);
+  }
+  saveSnapshot();
+
+  m_task = SETUP_TASK;
+  monitorTask = SETUP_TASK;
+  m_taskStartTime = micros();
+  enableWatchdog();
+}
+
+void LoopMonitor::startTask(uint8_t task) {
+  endTask();
+  wdt_reset();
+  m_task = task;
+  monitorTask = task;
+  m_taskStartTime = micros();
+}
+
+void LoopMonitor::recordFault(uint8_t task, uint8_t type, uint16_t overrun) {
+  Serial.print("Fault in task ");
+  Serial.println(task);
+  if (monitorSnapshot.loggedFaults >= FAULT_LOG_MAX_PER_POWER_CYCLE) {
+    return;
+  }
+  ++monitorSnapshot.loggedFaults;
+  saveSnapshot();
+
+  uint8_t nextRecord = EEPROM.read(FAULT_LOG_EEPROM_ADDR);
+  //erased EEPROM reads as 0xFF
+  if (nextRecord >= FAULT_LOG_RECORD_COUNT) {
+    nextRecord = 0;
+  }
+  FaultRecord record;
+  record.task = task;
+  record.type = type;
+  record.overrun = overrun;
+  EEPROM.put(FAULT_LOG_EEPROM_ADDR + 1 + nextRecord * sizeof(FaultRecord), record);
+  EEPROM.update(FAULT_LOG_EEPROM_ADDR, (nextRecord + 1) % FAULT_LOG_RECORD_COUNT);
+}
+
+void LoopMonitor::saveState(uint32_t totalPulses, const uint32_t* tripPulses) {
+  monitorSnapshot.hasState = true;
+  monitorSnapshot.totalPulses = totalPulses;
+  for (uint8_t trip = 0; trip < ODOMETER_TRIP_COUNT; ++trip) {
+    monitorSnapshot.tripPulses[trip] = tripPulses[trip];
+  }
+  saveSnapshot();
+}
+
+bool LoopMonitor::hasSavedState() {
+  return monitorSnapshot.hasState;
+}
+
+const MonitorSnapshot& LoopMonitor::savedState() {
+  return monitorSnapshot;
+}
+
+uint16_t LoopMonitor::overruns(uint8_t task) {
+  return m_overruns[task];
+}
+
+uint16_t LoopMonitor::worstOverrun(uint8_t task) {
+  return m_worstOverruns[task];
+}
+
+uint16_t LoopMonitor::totalOverruns() {
+  uint16_t total = 0;
+  for (uint8_t task = 0; task < LOOP_TASK_COUNT; ++task) {
+    total += m_overruns[task];
+  }
+  return total;
+}
+
+uint8_t LoopMonitor::worstTask() {
+  uint8_t worstTask = 0;
+  for (uint8_t task = 1; task < LOOP_TASK_COUNT; ++task) {
+    if (m_worstOverruns[task] > m_worstOverruns[worstTask]) {
+      worstTask = task;
+    }
+  }
+  return worstTask;
+}
+
+uint8_t LoopMonitor::watchdogResets() {
+  return monitorSnapshot.watchdogResets;
+}
+
+void LoopMonitor::printReport() {
+  //the report takes most of a second at 9600 baud
+  wdt_reset();
+  Serial.println("Task overruns:");
+  for (uint8_t task = 0; task < LOOP_TASK_COUNT; ++task) {
+    Serial.print("Task ");
+    Serial.print(task);
+    Serial.print(": ");
+    Serial.print(m_overruns[task]);
+    Serial.print(" overruns, worst ");
+    Serial.print(m_worstOverruns[task]);
+    Serial.println(" ms");
+  }
+  Serial.print("Watchdog resets: ");
+  Serial.println(monitorSnapshot.watchdogResets);
+
+  Serial.println("Fault log, oldest first:");
+  uint8_t nextRecord = EEPROM.read(FAULT_LOG_EEPROM_ADDR);
+  if (nextRecord >= FAULT_LOG_RECORD_COUNT) {
+    nextRecord = 0;
+  }
+  for (uint8_t i = 0; i < FAULT_LOG_RECORD_COUNT; ++i) {
+    FaultRecord record;
+    EEPROM.get(FAULT_LOG_EEPROM_ADDR + 1 + (nextRecord + i) % FAULT_LOG_RECORD_COUNT * sizeof(FaultRecord), record);
+    //skip erased records
+    if (record.task >= LOOP_TASK_COUNT) {
+      continue;
+    }
+    Serial.print("Task ");
+    Serial.print(record.task);
+    Serial.print(", type ");
+    Serial.print(record.type);
+    Serial.print(", overrun ");
+    Serial.print(record.overrun);
+    Serial.println(" ms");
+  }
+
+  //the running task starts over after the report
+  wdt_reset();
+  m_taskStartTime = micros();
+}
+
+/*
+
+
+
+    Private helper functions
+
+
+
+*/
+
+void LoopMonitor::endTask() {
+  unsigned long elapsed = micros() - m_taskStartTime;
+  uint32_t deadline = pgm_read_word(&LOOP_TASK_DEADLINES_MS[m_task]) * 1000UL;
+  if (elapsed <= deadline) {
+    return;
+  }
+
+  uint16_t overrun = min((elapsed - deadline) / 1000, 0xFFFFUL);
+  if (m_overruns[m_task] < 0xFFFF) {
+    ++m_overruns[m_task];
+  }
+  if (overrun > m_worstOverruns[m_task]) {
+    m_worstOverruns[m_task] = overrun;
+  }
+  if (!m_hasLoggedOverrun || millis() - m_prevFaultLogTime >= FAULT_LOG_INTERVAL_MS) {
+    m_hasLoggedOverrun = true;
+    m_prevFaultLogTime = millis();
+    recordFault(m_task, FAULT_OVERRUN, overrun);
+  }
+}
+
+void LoopMonitor::saveSnapshot() {
+  monitorSnapshot.checksum = checksum(monitorSnapshot);
+}
+
+uint8_t LoopMonitor::checksum(const MonitorSnapshot& snapshot) {
+  return crc8((const uint8_t*)&snapshot, offsetof(MonitorSnapshot, checksum));
+}
+
+void LoopMonitor::enableWatchdog() {
+  uint8_t oldSREG = SREG;
+  cli();
+  wdt_reset();
+  //timed sequence, the second write has to follow the first within 4 clock cycles
+  WDTCSR = _BV(WDCE) | _BV(WDE);
+  WDTCSR = _BV(WDIE) | _BV(WDE) | _BV(WDP2) | _BV(WDP1) | _BV(WDP0);
+  SREG = oldSREG;
+}
+
+ISR(WDT_vect) {
+  //a task hung, note which one and reset right away instead of after another timeout
+  watchdogTask = monitorTask;
+  watchdogMagic = MONITOR_SNAPSHOT_MAGIC;
+  wdt_enable(WDTO_15MS);
+}
@@ -0,0 +1,167 @@
+/*
+  Checks every task of the main loop against a deadline, backed by the hardware watchdog. A task that
+  runs past its deadline is counted, and a task that hangs is ended by a watchdog reset: the watchdog's
+  interrupt notes the hung task in RAM that isn't cleared on reset, and it's added to a small fault log
+  in the EEPROM when the dashboard starts again. The odometer is kept in the same RAM, so the distance
+  ridden since its last save survives the reset. The state of charge isn't kept, the first loop after the
+  reset estimates it from the battery voltage again, and with a BMS its percentage is only shown again
+  once its next packet arrives.
+*/
+
+#ifndef LOOP_MONITOR_H
+#define LOOP_MONITOR_H
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <avr/wdt.h>
+#include "Odometer.h"
+
+//storage area of the fault log, right after the odometer records
+#define FAULT_LOG_EEPROM_ADDR ODOMETER_EEPROM_END
+#define FAULT_LOG_RECORD_COUNT 16
+//the first byte holds the index of the record the next fault goes to
+#define FAULT_LOG_EEPROM_END (FAULT_LOG_EEPROM_ADDR + 1 + FAULT_LOG_RECORD_COUNT * sizeof(FaultRecord))
+
+//tasks of the main loop, in the order they run
+enum LoopTasks {
+  SETUP_TASK,
+  BATTERY_PERCENTAGE_TASK,
+  BATTERY_TEMPERATURE_TASK,
+  BATTERY_CURRENT_TASK,
+  LIGHT_STATES_TASK,
+  SPEED_TASK,
+  ODOMETER_TASK,
+  TELEMETRY_TASK,
+  WARNINGS_TASK,
+  DISPLAY_TASK,
+  MONITOR_TASK,
+  LOOP_TASK_COUNT,
+};
+
+//time budget of each task in milliseconds. Most of it goes to the debug output over serial, which takes about
+//1ms per character at 9600 baud, so each budget is the task's longest output plus its EEPROM writes, with about
+//a third of margin. Check them against the worst overruns in the report printed by MONITOR_REPORT_COMMAND
+constexpr uint16_t LOOP_TASK_DEADLINES_MS[LOOP_TASK_COUNT] PROGMEM = {
+  2000, //setup, only bounded by the watchdog
+  120, //battery percentage, with the warning for a reference voltage out of range
+  50, 50, //battery temperature and current
+  150, //lights, a line for each of the four lights
+  160, //speed, with a finished run and a new best run saved to the EEPROM
+  130, //odometer, a save writes 16 bytes to the EEPROM at 3.3ms each
+  80, //telemetry, with faults reported by the controller and the BMS
+  300, //warnings, with every warning shown
+  800, //display, a page change redraws the whole page
+  30, //monitor, the report it prints on request isn't counted
+};
+
+/*
+  Returns the longest deadline of the loop's tasks, setup isn't part of the loop
+*/
+constexpr uint16_t longestTaskDeadline(uint8_t task = SETUP_TASK + 1, uint16_t longest = 0) {
+  return task == LOOP_TASK_COUNT ? longest
+         : longestTaskDeadline(task + 1, LOOP_TASK_DEADLINES_MS[task] > longest ? LOOP_TASK_DEADLINES_MS[task] : longest);
+}
+
+enum FaultTypes {
+  FAULT_OVERRUN, //a task ran past its deadline
+  FAULT_WATCHDOG_RESET, //a task hung and the watchdog reset the dashboard
+  FAULT_NO_DISPLAY, //the display didn't respond at startup
+};
+
+enum LoopMonitorConstants {
+  //a hung task is reset after this long, the timeout of WDTO_2S
+  WATCHDOG_TIMEOUT_MS = 2000,
+  //overruns are only logged this far apart so a slow task doesn't wear out the EEPROM
+  FAULT_LOG_INTERVAL_MS = 60000,
+  //faults logged per power cycle, so a reset loop doesn't wear out the EEPROM either
+  FAULT_LOG_MAX_PER_POWER_CYCLE = 8,
+  MONITOR_SNAPSHOT_MAGIC = 0x5AFE,
+  //prints the overrun counts and the fault log when received over serial
+  MONITOR_REPORT_COMMAND = 'm',
+};
+
+//one fault in the EEPROM log, 4 bytes
+struct FaultRecord {
+  uint8_t task;
+  uint8_t type;
+  uint16_t overrun; //time past the deadline in milliseconds
+};
+
+//state kept in RAM across a reset
+struct MonitorSnapshot {
+  uint16_t magic;
+  uint8_t watchdogResets; //watchdog resets since the power came on
+  uint8_t loggedFaults; //faults logged since the power came on
+  bool hasState; //the values below have been saved
+  uint32_t totalPulses;
+  uint32_t tripPulses[ODOMETER_TRIP_COUNT];
+  uint8_t checksum;
+};
+
+class LoopMonitor {
+
+  private:
+    uint8_t m_task; //task currently running
+    unsigned long m_taskStartTime; //in microseconds
+    uint16_t m_overruns[LOOP_TASK_COUNT];
+    uint16_t m_worstOverruns[LOOP_TASK_COUNT]; //in milliseconds
+    unsigned long m_prevFaultLogTime;
+    bool m_hasLoggedOverrun;
+
+    /*
+      Checks the running task against its deadline
+    */
+    void endTask();
+    /*
+      Updates the checksum after a change to the snapshot
+    */
+    void saveSnapshot();
+    /*
+      Returns the CRC-8 of every byte of the snapshot before the checksum
+    */
+    static uint8_t checksum(const MonitorSnapshot& snapshot);
+    /*
+      Enables the watchdog in interrupt and reset mode, the interrupt runs first and the reset follows
+    */
+    static void enableWatchdog();
+
+  public:
+    LoopMonitor();
+    /*
+      Logs the task that hung if the dashboard was reset by the watchdog, and starts the watchdog
+      Call first thing at startup
+    */
+    void begin();
+    /*
+      Ends the running task and starts the next one, which also resets the watchdog
+    */
+    void startTask(uint8_t task);
+    /*
+      Adds a fault to the EEPROM log, unless this power cycle already logged too many
+      @param overrun is the time past the deadline in milliseconds
+    */
+    void recordFault(uint8_t task, uint8_t type, uint16_t overrun);
+    /*
+      Keeps state in RAM that survives a reset, call once per loop
+    */
+    void saveState(uint32_t totalPulses, const uint32_t* tripPulses);
+    /*
+      Returns false if there's no state from before a reset, like after a power cycle
+    */
+    bool hasSavedState();
+    const MonitorSnapshot& savedState();
+    uint16_t overruns(uint8_t task);
+    uint16_t worstOverrun(uint8_t task);
+    uint16_t totalOverruns();
+    /*
+      Returns the task with the longest overrun
+    */
+    uint8_t worstTask();
+    uint8_t watchdogResets();
+    /*
+      Prints the overrun counts and the fault log over serial, the time it takes isn't counted against the running task
+    */
+    void printReport();
+};
+
+#endif
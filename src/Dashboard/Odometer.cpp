@@ -0,0 +1,141 @@
+#include "Odometer.h"
+#include <stddef.h>
+#include "Crc8.h"
+
+/*
+   Constructor
+*/
+Odometer::Odometer()
+  : m_totalPulses(0), m_tripPulses{0, 0}, m_unsavedPulses(0), m_hasUnsavedReset(false)
+  , m_lastSaveTime(0), m_sequence(0), m_nextRecord(0), m_isPowerOn(true), m_isPowerSenseOn(true)
+  , m_powerSenseChangeTime(0)
+{
+}
+
+void Odometer::begin() {
+  Serial.println("Loading odometer");
+  bool hasRecord = false;
+
+  //find the valid record with the newest sequence number, the sequence number wraps around
+  for (uint8_t i = 0; i < ODOMETER_RECORD_COUNT; ++i) {
+    OdometerRecord record;
+    EEPROM.get(ODOMETER_EEPROM_ADDR + i * sizeof(OdometerRecord), record);
+    if (!isValid(record)) {
+      continue;
+    }
+    if (!hasRecord || (int16_t)(record.sequence - m_sequence) > 0) {
+      hasRecord = true;
+      m_sequence = record.sequence;
+      m_nextRecord = (i + 1) % ODOMETER_RECORD_COUNT;
+      m_totalPulses = record.totalPulses;
+      for (uint8_t trip = 0; trip < ODOMETER_TRIP_COUNT; ++trip) {
+        m_tripPulses[trip] = record.tripPulses[trip];
+      }
+    }
+  }
+
+  if (!hasRecord) {
+    Serial.println("No odometer record found");
+  }
+  m_lastSaveTime = millis();
+}
+
+void Odometer::addPulses(uint8_t pulses) {
+  m_totalPulses += pulses;
+  for (uint8_t trip = 0; trip < ODOMETER_TRIP_COUNT; ++trip) {
+    m_tripPulses[trip] += pulses;
+  }
+  m_unsavedPulses += pulses;
+}
+
+void Odometer::update(bool isPowerOn) {
+  unsigned long currentTime = millis();
+  if (isPowerOn != m_isPowerSenseOn) {
+    m_isPowerSenseOn = isPowerOn;
+    m_powerSenseChangeTime = currentTime;
+  }
+  if (m_isPowerSenseOn != m_isPowerOn && currentTime - m_powerSenseChangeTime >= ODOMETER_POWER_SENSE_DEBOUNCE_MS) {
+    Serial.println(m_isPowerSenseOn ? "Power on" : "Power down");
+    m_isPowerOn = m_isPowerSenseOn;
+  }
+
+  bool hasUnsavedChanges = m_unsavedPulses > 0 || m_hasUnsavedReset;
+  if (!hasUnsavedChanges) {
+    return;
+  }
+
+  //save soon after the power goes down, otherwise batch the saves by distance and time
+  unsigned long timeSinceSave = currentTime - m_lastSaveTime;
+  if ((!m_isPowerOn && timeSinceSave >= ODOMETER_MIN_POWER_DOWN_SAVE_INTERVAL_MS)
+      || (m_unsavedPulses >= ODOMETER_SAVE_PULSES && timeSinceSave >= ODOMETER_MIN_SAVE_INTERVAL_MS)
+      || timeSinceSave >= ODOMETER_MAX_SAVE_INTERVAL_MS) {
+    save();
+  }
+}
+
+void Odometer::resetTrip(uint8_t trip) {
+  Serial.println("Resetting trip meter");
+  m_tripPulses[trip] = 0;
+  m_hasUnsavedReset = true;
+}
+
+void Odometer::restore(uint32_t totalPulses, const uint32_t* tripPulses) {
+  //the records are never ahead of RAM, anything else isn't from this odometer
+  if (totalPulses < m_totalPulses) {
+    return;
+  }
+  Serial.println("Restoring odometer");
+  m_unsavedPulses += totalPulses - m_totalPulses;
+  m_totalPulses = totalPulses;
+  for (uint8_t trip = 0; trip < ODOMETER_TRIP_COUNT; ++trip) {
+    m_tripPulses[trip] = tripPulses[trip];
+  }
+  //a trip might have been reset since the last save
+  m_hasUnsavedReset = true;
+}
+
+uint32_t Odometer::totalPulses() {
+  return m_totalPulses;
+}
+
+uint32_t Odometer::tripPulses(uint8_t trip) {
+  return m_tripPulses[trip];
+}
+
+/*
+
+
+
+    Private helper functions
+
+
+
+*/
+
+void Odometer::save() {
+  Serial.println("Saving odometer");
+  OdometerRecord record;
+  record.magic = ODOMETER_RECORD_MAGIC;
+  record.sequence = m_sequence + 1;
+  record.totalPulses = m_totalPulses;
+  for (uint8_t trip = 0; trip < ODOMETER_TRIP_COUNT; ++trip) {
+    record.tripPulses[trip] = m_tripPulses[trip];
+  }
+  record.checksum = checksum(record);
+
+  EEPROM.put(ODOMETER_EEPROM_ADDR + m_nextRecord * sizeof(OdometerRecord), record);
+
+  m_sequence = record.sequence;
+  m_nextRecord = (m_nextRecord + 1) % ODOMETER_RECORD_COUNT;
+  m_unsavedPulses = 0;
+  m_hasUnsavedReset = false;
+  m_lastSaveTime = millis();
+}
+
+uint8_t Odometer::checksum(const OdometerRecord& record) {
+  return crc8((const uint8_t*)&record, offsetof(OdometerRecord, checksum));
+}
+
+bool Odometer::isValid(const OdometerRecord& record) {
+  return record.magic == ODOMETER_RECORD_MAGIC && record.checksum == checksum(record);
+}
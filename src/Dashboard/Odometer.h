@@ -0,0 +1,102 @@
+/*
+  Odometer and trip meters for the dashboard. Distances are counted in wheel pulses in RAM and saved
+  to a ring of records in the EEPROM. Each save goes to the next record in the ring with a higher
+  sequence number, so every EEPROM cell only gets written once every ODOMETER_RECORD_COUNT saves.
+*/
+
+#ifndef ODOMETER_H
+#define ODOMETER_H
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "Profiles.h"
+
+//storage area of the odometer records at the start of the EEPROM
+#define ODOMETER_EEPROM_ADDR 0
+#define ODOMETER_RECORD_COUNT 32
+#define ODOMETER_TRIP_COUNT 2
+
+enum OdometerConstants {
+  ODOMETER_RECORD_MAGIC = 0xA5, //marks a record as written by the odometer
+  //saves are at least this far apart so EEPROM writes stay within its endurance at any speed
+  ODOMETER_MIN_SAVE_INTERVAL_MS = 60000,
+  //any unsaved distance gets saved after this long, e.g. when riding slowly
+  ODOMETER_MAX_SAVE_INTERVAL_MS = 300000,
+  //the power sense line has to stay at a level this long before it counts, so noise on it doesn't cause saves
+  ODOMETER_POWER_SENSE_DEBOUNCE_MS = 50,
+  //a save while the power is down waits until this long after the previous save, so a line that keeps switching
+  //anyway can't wear out the EEPROM. Distance from this long before the power went down can be lost
+  ODOMETER_MIN_POWER_DOWN_SAVE_INTERVAL_MS = 5000,
+};
+
+//one record in the EEPROM ring, 16 bytes
+struct OdometerRecord {
+  uint8_t magic;
+  uint16_t sequence; //incremented with every save, the record with the highest one is the newest
+  uint32_t totalPulses;
+  uint32_t tripPulses[ODOMETER_TRIP_COUNT];
+  uint8_t checksum; //written last, so a save interrupted by a power loss leaves an invalid record
+};
+
+//unsaved distance in wheel pulses that triggers a save, half a mile
+constexpr uint32_t ODOMETER_SAVE_PULSES = PULSES_PER_MILE / 2;
+
+#define ODOMETER_EEPROM_END (ODOMETER_EEPROM_ADDR + ODOMETER_RECORD_COUNT * sizeof(OdometerRecord))
+
+class Odometer {
+
+  private:
+    uint32_t m_totalPulses;
+    uint32_t m_tripPulses[ODOMETER_TRIP_COUNT];
+    uint32_t m_unsavedPulses; //pulses counted since the last save
+    bool m_hasUnsavedReset; //a trip was reset since the last save
+    unsigned long m_lastSaveTime;
+    uint16_t m_sequence; //sequence number of the newest record
+    uint8_t m_nextRecord; //index of the record the next save goes to
+    bool m_isPowerOn; //debounced state of the power sense input
+    bool m_isPowerSenseOn; //state of the power sense input at the last update
+    unsigned long m_powerSenseChangeTime; //time the power sense input last changed
+
+    void save();
+    /*
+      Returns the CRC-8 of every byte of the record before the checksum
+    */
+    static uint8_t checksum(const OdometerRecord& record);
+    /*
+      Returns true if the record was completely written by the odometer
+    */
+    static bool isValid(const OdometerRecord& record);
+
+  public:
+    Odometer();
+    /*
+      Loads the distances from the newest valid record in the EEPROM
+    */
+    void begin();
+    /*
+      @param pulses is the number of wheel pulses counted since the last call
+    */
+    void addPulses(uint8_t pulses);
+    /*
+      Saves the distances when enough distance or time has built up since the last save, or soon after the
+      power goes down
+      @param isPowerOn is the state of the power sense input
+    */
+    void update(bool isPowerOn);
+    /*
+      @param trip is the trip meter to reset, 0 or 1
+    */
+    void resetTrip(uint8_t trip);
+    /*
+      Restores distances kept in RAM across a reset, which can be ahead of the newest record
+      Call after begin()
+    */
+    void restore(uint32_t totalPulses, const uint32_t* tripPulses);
+    uint32_t totalPulses();
+    /*
+      @param trip is the trip meter to read, 0 or 1
+    */
+    uint32_t tripPulses(uint8_t trip);
+};
+
+#endif
@@ -0,0 +1,290 @@
+#include "PerformanceTimer.h"
+#include <stddef.h>
+#include "Crc8.h"
+
+//ring buffer of pulse times
+volatile unsigned long performancePulseTimes[PERFORMANCE_BUFFER_SIZE];
+volatile uint8_t performanceHead = 0; //only written by recordPulse()
+volatile uint8_t performanceTail = 0; //only written by the main loop
+volatile uint16_t performanceOverruns = 0;
+volatile bool isPerformanceEnabled = false;
+
+//1 in/us = 56818.18 mph
+constexpr float INCHES_PER_MICROSECOND_TO_MPH = 56818.18;
+
+/*
+   Constructor
+*/
+PerformanceTimer::PerformanceTimer()
+  : m_state(PERFORMANCE_WAITING), m_prevPulseTime(0), m_prevSpeedTime(0), m_pulseCount(0)
+  , m_speed(0), m_acceleration(0), m_startTime(0), m_distance(0), m_runOverruns(0)
+{
+  clearRun(m_lastRun);
+  clearRun(m_bestRun);
+}
+
+void PerformanceTimer::begin() {
+  EEPROM.get(PERFORMANCE_EEPROM_ADDR, m_bestRun);
+  if (m_bestRun.magic != PERFORMANCE_RECORD_MAGIC || m_bestRun.checksum != checksum(m_bestRun)) {
+    Serial.println("No best run found");
+    clearRun(m_bestRun);
+  }
+}
+
+void PerformanceTimer::setEnabled(bool isEnabled) {
+  if (isEnabled == isPerformanceEnabled) {
+    return;
+  }
+  Serial.println(isEnabled ? "Performance mode on" : "Performance mode off");
+  //drop any pulses left from before, the interrupt doesn't write while disabled
+  isPerformanceEnabled = false;
+  performanceTail = performanceHead;
+  m_state = PERFORMANCE_WAITING;
+  m_prevPulseTime = micros();
+  m_speed = 0;
+  m_acceleration = 0;
+  isPerformanceEnabled = isEnabled;
+}
+
+void PerformanceTimer::update() {
+  if (!isPerformanceEnabled) {
+    return;
+  }
+
+  //only this reads the head and writes the tail, the interrupt does the opposite
+  while (performanceTail != performanceHead) {
+    uint8_t tail = performanceTail;
+    unsigned long pulseTime = performancePulseTimes[tail & (PERFORMANCE_BUFFER_SIZE - 1)];
+    performanceTail = tail + 1;
+    addPulse(pulseTime);
+  }
+  if (m_state == PERFORMANCE_RUNNING && overruns() != m_runOverruns) {
+    abortRun();
+  }
+
+  //no pulses for a while means the vehicle has stopped, read the time after the pulses so it's not older than them
+  if (micros() - m_prevPulseTime >= PERFORMANCE_STANDSTILL_MS * 1000UL) {
+    m_speed = 0;
+    m_acceleration = 0;
+    if (m_state == PERFORMANCE_RUNNING) {
+      Serial.println("Run stopped");
+      finishRun();
+    }
+    if (m_state != PERFORMANCE_READY) {
+      Serial.println("Ready for a run");
+      m_state = PERFORMANCE_READY;
+      m_runOverruns = overruns();
+    }
+  }
+}
+
+uint8_t PerformanceTimer::state() {
+  return m_state;
+}
+
+int16_t PerformanceTimer::speed() {
+  return m_speed * 10 + 0.5;
+}
+
+int16_t PerformanceTimer::acceleration() {
+  return m_acceleration * 10;
+}
+
+const PerformanceRecord& PerformanceTimer::lastRun() {
+  return m_lastRun;
+}
+
+const PerformanceRecord& PerformanceTimer::bestRun() {
+  return m_bestRun;
+}
+
+void PerformanceTimer::clearBestRun() {
+  Serial.println("Clearing best run");
+  clearRun(m_bestRun);
+  m_bestRun.checksum = checksum(m_bestRun);
+  EEPROM.put(PERFORMANCE_EEPROM_ADDR, m_bestRun);
+}
+
+void PerformanceTimer::recordPulse(unsigned long time) {
+  if (!isPerformanceEnabled) {
+    return;
+  }
+  uint8_t head = performanceHead;
+  if ((uint8_t)(head - performanceTail) == PERFORMANCE_BUFFER_SIZE) {
+    ++performanceOverruns;
+    return;
+  }
+  performancePulseTimes[head & (PERFORMANCE_BUFFER_SIZE - 1)] = time;
+  performanceHead = head + 1;
+}
+
+uint16_t PerformanceTimer::overruns() {
+  noInterrupts();
+  uint16_t count = performanceOverruns;
+  interrupts();
+  return count;
+}
+
+/*
+
+
+
+    Private helper functions
+
+
+
+*/
+
+void PerformanceTimer::addPulse(unsigned long time) {
+  unsigned long prevPulseTime = m_prevPulseTime;
+  unsigned long interval = time - prevPulseTime;
+  //a bounce can record a second pulse within the same tick of micros(), which has no speed
+  if (interval == 0) {
+    return;
+  }
+  m_prevPulseTime = time;
+
+  //the first pulse after a standstill starts a run, but there's no interval to measure yet
+  if (m_state == PERFORMANCE_READY) {
+    Serial.println("Run started");
+    m_state = PERFORMANCE_RUNNING;
+    clearRun(m_lastRun);
+    m_pulseCount = 0;
+    m_distance = 0;
+    m_speed = 0;
+    m_startTime = time;
+    m_prevSpeedTime = time;
+    return;
+  }
+
+  //the speed over the interval is measured at its middle
+  float prevSpeed = m_speed;
+  unsigned long prevSpeedTime = m_prevSpeedTime;
+  unsigned long speedTime = prevPulseTime + interval / 2;
+  m_speed = WHEEL_CIRCUMFERENCE_INCHES * INCHES_PER_MICROSECOND_TO_MPH / interval;
+  m_acceleration = (m_speed - prevSpeed) * 1000000 / (speedTime - prevSpeedTime);
+  m_prevSpeedTime = speedTime;
+
+  if (m_state != PERFORMANCE_RUNNING) {
+    return;
+  }
+  if (m_pulseCount < 0xFF) {
+    ++m_pulseCount;
+  }
+  if (m_pulseCount < 2) {
+    return;
+  }
+
+  float prevDistance = m_distance;
+  if (m_pulseCount == 2) {
+    //the wheel turned by an unknown amount before the first pulse, so estimate when it started moving
+    //by following the first two speeds back to 0, assuming the acceleration stays the same
+    unsigned long firstPulseTime = m_startTime;
+    unsigned long firstInterval = (prevSpeedTime - firstPulseTime) * 2;
+    //from a standstill at a constant acceleration, the first pulse comes at most ~2.4 first intervals after the start
+    unsigned long minTimeFromStart = firstInterval / 2;
+    unsigned long maxTimeFromStart = minTimeFromStart + 3 * firstInterval;
+    unsigned long timeFromStart = maxTimeFromStart;
+    if (m_speed > prevSpeed) {
+      timeFromStart = prevSpeed * (speedTime - prevSpeedTime) / (m_speed - prevSpeed);
+      timeFromStart = constrain(timeFromStart, minTimeFromStart, maxTimeFromStart);
+    }
+    m_startTime = prevSpeedTime - timeFromStart;
+    //distance covered before the first pulse, at the average of the speeds from 0 at the start
+    float firstPulseSpeed = prevSpeed * (firstPulseTime - m_startTime) / (prevSpeedTime - m_startTime);
+    float firstPulseDistance = firstPulseSpeed / INCHES_PER_MICROSECOND_TO_MPH * (firstPulseTime - m_startTime) / 2;
+    prevDistance = min(firstPulseDistance, WHEEL_CIRCUMFERENCE_INCHES) + WHEEL_CIRCUMFERENCE_INCHES;
+    //look for the speed crossings from the start
+    prevSpeed = 0;
+    prevSpeedTime = m_startTime;
+  }
+  m_distance = prevDistance + WHEEL_CIRCUMFERENCE_INCHES;
+
+  updateRun(prevSpeed, prevSpeedTime, prevDistance, prevPulseTime);
+}
+
+void PerformanceTimer::updateRun(float prevSpeed, unsigned long prevSpeedTime, float prevDistance, unsigned long prevPulseTime) {
+  unsigned long speedTime = m_prevSpeedTime;
+
+  //interpolate when the speed crossed the target speeds between the two measurements
+  if (m_lastRun.lowSpeedTime == PERFORMANCE_NO_TIME && m_speed >= PERFORMANCE_LOW_SPEED) {
+    float fraction = (PERFORMANCE_LOW_SPEED - prevSpeed) / (m_speed - prevSpeed);
+    m_lastRun.lowSpeedTime = runTime(prevSpeedTime + (unsigned long)(fraction * (speedTime - prevSpeedTime)));
+  }
+  if (m_lastRun.highSpeedTime == PERFORMANCE_NO_TIME && m_speed >= PERFORMANCE_HIGH_SPEED) {
+    float fraction = (PERFORMANCE_HIGH_SPEED - prevSpeed) / (m_speed - prevSpeed);
+    m_lastRun.highSpeedTime = runTime(prevSpeedTime + (unsigned long)(fraction * (speedTime - prevSpeedTime)));
+  }
+
+  //the speed is constant enough within a pulse to interpolate the distance linearly
+  if (m_distance >= QUARTER_MILE_INCHES) {
+    float fraction = (QUARTER_MILE_INCHES - prevDistance) / WHEEL_CIRCUMFERENCE_INCHES;
+    m_lastRun.quarterMileTime = runTime(prevPulseTime + (unsigned long)(fraction * (m_prevPulseTime - prevPulseTime)));
+    m_lastRun.trapSpeed = min(m_speed + 0.5, 255.0);
+    finishRun();
+  }
+}
+
+void PerformanceTimer::finishRun() {
+  //the interrupt might have dropped a pulse since update() last checked
+  if (overruns() != m_runOverruns) {
+    abortRun();
+    return;
+  }
+
+  Serial.print("Run times (ms): ");
+  Serial.print(m_lastRun.lowSpeedTime);
+  Serial.print(", ");
+  Serial.print(m_lastRun.highSpeedTime);
+  Serial.print(", ");
+  Serial.println(m_lastRun.quarterMileTime);
+
+  //each time is kept separately, the best 0-60 doesn't have to be from the best quarter mile
+  bool isBetter = false;
+  if (m_lastRun.lowSpeedTime < m_bestRun.lowSpeedTime) {
+    m_bestRun.lowSpeedTime = m_lastRun.lowSpeedTime;
+    isBetter = true;
+  }
+  if (m_lastRun.highSpeedTime < m_bestRun.highSpeedTime) {
+    m_bestRun.highSpeedTime = m_lastRun.highSpeedTime;
+    isBetter = true;
+  }
+  if (m_lastRun.quarterMileTime < m_bestRun.quarterMileTime) {
+    m_bestRun.quarterMileTime = m_lastRun.quarterMileTime;
+    m_bestRun.trapSpeed = m_lastRun.trapSpeed;
+    isBetter = true;
+  }
+  if (isBetter) {
+    Serial.println("Saving best run");
+    m_bestRun.checksum = checksum(m_bestRun);
+    EEPROM.put(PERFORMANCE_EEPROM_ADDR, m_bestRun);
+  }
+
+  //the next run needs another standstill
+  m_state = PERFORMANCE_WAITING;
+}
+
+void PerformanceTimer::abortRun() {
+  Serial.println("Run aborted, pulses were dropped");
+  clearRun(m_lastRun);
+  //the next run needs another standstill
+  m_state = PERFORMANCE_WAITING;
+}
+
+uint16_t PerformanceTimer::runTime(unsigned long time) {
+  unsigned long milliseconds = (time - m_startTime + 500) / 1000;
+  return min(milliseconds, (unsigned long)PERFORMANCE_NO_TIME - 1);
+}
+
+void PerformanceTimer::clearRun(PerformanceRecord& run) {
+  run.magic = PERFORMANCE_RECORD_MAGIC;
+  run.lowSpeedTime = PERFORMANCE_NO_TIME;
+  run.highSpeedTime = PERFORMANCE_NO_TIME;
+  run.quarterMileTime = PERFORMANCE_NO_TIME;
+  run.trapSpeed = 0;
+  run.checksum = 0;
+}
+
+uint8_t PerformanceTimer::checksum(const PerformanceRecord& run) {
+  return crc8((const uint8_t*)&run, offsetof(PerformanceRecord, checksum));
+}
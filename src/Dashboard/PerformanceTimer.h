@@ -0,0 +1,128 @@
+/*
+  Times acceleration runs from the wheel pulses. While enabled, the speed sensor's interrupt puts the
+  time of every pulse into a lock-free ring buffer, which the main loop drains to get the speed and
+  acceleration of every pulse. A run starts from a standstill and its 0-30 mph, 0-60 mph and quarter
+  mile times are interpolated between pulses, so they're much finer than the time between pulses.
+  The best times are kept in the EEPROM.
+*/
+
+#ifndef PERFORMANCE_TIMER_H
+#define PERFORMANCE_TIMER_H
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "Profiles.h"
+#include "LoopMonitor.h"
+
+//storage area of the best times, right after the fault log
+#define PERFORMANCE_EEPROM_ADDR FAULT_LOG_EEPROM_END
+#define PERFORMANCE_EEPROM_END (PERFORMANCE_EEPROM_ADDR + sizeof(PerformanceRecord))
+//pulse times waiting for the main loop, must be a power of 2
+#define PERFORMANCE_BUFFER_SIZE 32
+//times that haven't been set
+#define PERFORMANCE_NO_TIME 0xFFFF
+
+enum PerformanceConstants {
+  PERFORMANCE_LOW_SPEED = 30, //mph
+  PERFORMANCE_HIGH_SPEED = 60,
+  QUARTER_MILE_INCHES = 15840,
+  //the wheel has to stay still this long before a run can start, and a run ends if it stops this long
+  PERFORMANCE_STANDSTILL_MS = 1000,
+  PERFORMANCE_RECORD_MAGIC = 0x5C,
+};
+
+enum PerformanceStates {
+  PERFORMANCE_WAITING, //waiting for the vehicle to stop
+  PERFORMANCE_READY, //stopped, the next pulse starts a run
+  PERFORMANCE_RUNNING,
+};
+
+//times of a run in milliseconds
+struct PerformanceRecord {
+  uint8_t magic;
+  uint16_t lowSpeedTime; //0 to PERFORMANCE_LOW_SPEED
+  uint16_t highSpeedTime; //0 to PERFORMANCE_HIGH_SPEED
+  uint16_t quarterMileTime;
+  uint8_t trapSpeed; //speed at the end of the quarter mile in mph
+  uint8_t checksum;
+};
+
+class PerformanceTimer {
+
+  private:
+    uint8_t m_state;
+    unsigned long m_prevPulseTime; //in microseconds
+    unsigned long m_prevSpeedTime; //middle of the previous pulse interval
+    uint8_t m_pulseCount; //pulses since the run started, stops counting at 255
+    float m_speed; //in mph
+    float m_acceleration; //in mph/s
+    unsigned long m_startTime; //estimated time the vehicle started moving
+    float m_distance; //distance since the start in inches
+    uint16_t m_runOverruns; //overruns before the run, any more and the run has a gap
+    PerformanceRecord m_lastRun;
+    PerformanceRecord m_bestRun;
+
+    /*
+      Updates speed, acceleration and the run with the next pulse
+      @param time is the time of the pulse in microseconds
+    */
+    void addPulse(unsigned long time);
+    /*
+      Records the run's times that were passed between the previous pulse and this one
+      @param prevSpeed is the speed measured at prevSpeedTime
+      @param prevDistance is the distance at prevPulseTime
+    */
+    void updateRun(float prevSpeed, unsigned long prevSpeedTime, float prevDistance, unsigned long prevPulseTime);
+    /*
+      Keeps any time of the last run that's better than the best one, and saves the best run
+    */
+    void finishRun();
+    /*
+      Drops the run, a pulse was lost so its distance and times are wrong
+    */
+    void abortRun();
+    /*
+      Returns the milliseconds since the run started, clamped below PERFORMANCE_NO_TIME
+    */
+    uint16_t runTime(unsigned long time);
+    static void clearRun(PerformanceRecord& run);
+    static uint8_t checksum(const PerformanceRecord& run);
+
+  public:
+    PerformanceTimer();
+    /*
+      Loads the best run from the EEPROM
+    */
+    void begin();
+    /*
+      Starts or stops recording pulses, switching on starts over from PERFORMANCE_WAITING
+    */
+    void setEnabled(bool isEnabled);
+    /*
+      Processes the pulses recorded since the last call
+    */
+    void update();
+    uint8_t state();
+    /*
+      Returns the speed at the last pulse in tenths of a mph
+    */
+    int16_t speed();
+    /*
+      Returns the acceleration at the last pulse in tenths of a mph per second
+    */
+    int16_t acceleration();
+    const PerformanceRecord& lastRun();
+    const PerformanceRecord& bestRun();
+    void clearBestRun();
+    /*
+      Adds a pulse to the ring buffer, called from the speed sensor's interrupt
+      @param time is the time of the pulse in microseconds
+    */
+    static void recordPulse(unsigned long time);
+    /*
+      Returns the number of pulses dropped because the ring buffer was full, a run that drops any is aborted
+    */
+    static uint16_t overruns();
+};
+
+#endif
@@ -0,0 +1,139 @@
+/*
+  Vehicle and battery profiles. Each profile is a specialization of VehicleTraits or BatteryTraits,
+  select the ones to build with VEHICLE_PROFILE and BATTERY_PROFILE. Everything derived from the
+  profiles is a constexpr, so switching bikes doesn't cost anything at runtime.
+*/
+
+#ifndef PROFILES_H
+#define PROFILES_H
+
+#include <Arduino.h>
+
+//list of vehicle profiles
+enum VehicleProfiles {
+  BENCH_VEHICLE, //signal generator on the bench, 1" wheel
+  STREET_BIKE_17, //17" rim street bike
+};
+
+//list of battery profiles
+enum BatteryProfiles {
+  BENCH_BATTERY, //9-12V bench supply
+  LIFEPO4_16S, //16 cell (51.2V nominal) LiFePO4 pack
+};
+
+//profiles to build the dashboard for, can also be set from the compiler's command line
+#ifndef VEHICLE_PROFILE
+#define VEHICLE_PROFILE BENCH_VEHICLE
+#endif
+#ifndef BATTERY_PROFILE
+#define BATTERY_PROFILE BENCH_BATTERY
+#endif
+
+template <uint8_t Profile> struct VehicleTraits;
+
+template <> struct VehicleTraits<BENCH_VEHICLE> {
+  static constexpr float wheelDiameterInches = 1.0; //diameter of the wheel including the tire
+  static constexpr uint8_t maxSpeed = 120; //maximum speed in mph
+  static constexpr float motorToWheelRatio = 1.0; //motor revolutions per wheel revolution
+};
+
+template <> struct VehicleTraits<STREET_BIKE_17> {
+  static constexpr float wheelDiameterInches = 24.5;
+  static constexpr uint8_t maxSpeed = 80;
+  static constexpr float motorToWheelRatio = 4.2;
+};
+
+//state of charge curves in flash, battery voltage in millivolts at 0%, 10%, ... 100%
+#define SOC_CURVE_POINTS 11
+constexpr uint16_t BENCH_BATTERY_SOC_CURVE[SOC_CURVE_POINTS] PROGMEM = {
+  9000, 9300, 9600, 9900, 10200, 10500, 10800, 11100, 11400, 11700, 12000,
+};
+constexpr uint16_t LIFEPO4_16S_SOC_CURVE[SOC_CURVE_POINTS] PROGMEM = {
+  40000, 48000, 51200, 51600, 52000, 52300, 52500, 52700, 53000, 53300, 54400,
+};
+
+template <uint8_t Profile> struct BatteryTraits;
+
+template <> struct BatteryTraits<BENCH_BATTERY> {
+  static constexpr uint16_t minVoltage = 9000; //battery minimum voltage in millivolts
+  static constexpr uint16_t maxVoltage = 12000; //battery maximum voltage in millivolts
+  static constexpr float dividerRatio = 4.0; //voltage divider ratio for the sensing circuit
+  static constexpr int8_t minCurrent = -50; //current sensor range in amperes
+  static constexpr int8_t maxCurrent = 50;
+  static constexpr int8_t minTemp = -100; //temperature sensor range in degrees celsius
+  static constexpr int8_t maxTemp = 100;
+  static constexpr int8_t overheatThreshold = 60; //battery overheat threshold in degrees celsius
+  static constexpr int8_t lowTempThreshold = -20; //battery low temperature threshold in degrees celsius
+  static constexpr uint8_t lowBatteryThreshold = 20; //low battery warning threshold in percent
+  static constexpr uint16_t imbalanceThreshold = 100; //maximum difference between cell voltages in millivolts
+  static constexpr uint32_t capacity = 2000; //battery capacity in milliampere-hours
+  static constexpr uint16_t terminationCurrent = 1; //charging current in 0.1A at which the battery is full
+  static constexpr const uint16_t* socCurve = BENCH_BATTERY_SOC_CURVE;
+};
+
+template <> struct BatteryTraits<LIFEPO4_16S> {
+  static constexpr uint16_t minVoltage = 40000;
+  static constexpr uint16_t maxVoltage = 58400;
+  static constexpr float dividerRatio = 12.0;
+  static constexpr int8_t minCurrent = -100;
+  static constexpr int8_t maxCurrent = 100;
+  static constexpr int8_t minTemp = -40;
+  static constexpr int8_t maxTemp = 125;
+  static constexpr int8_t overheatThreshold = 55;
+  static constexpr int8_t lowTempThreshold = 0; //LiFePO4 can't be charged below freezing
+  static constexpr uint8_t lowBatteryThreshold = 20;
+  static constexpr uint16_t imbalanceThreshold = 50;
+  static constexpr uint32_t capacity = 40000;
+  static constexpr uint16_t terminationCurrent = 20;
+  static constexpr const uint16_t* socCurve = LIFEPO4_16S_SOC_CURVE;
+};
+
+//profiles the dashboard is built with
+typedef VehicleTraits<VEHICLE_PROFILE> Vehicle;
+typedef BatteryTraits<BATTERY_PROFILE> BatteryPack;
+
+//scale factors derived from the profiles
+constexpr float WHEEL_CIRCUMFERENCE_INCHES = PI * Vehicle::wheelDiameterInches;
+//speed in mph = wheel pulses * SPEED_SCALE / time between them in microseconds (1 in/us = 56818.18 mph)
+constexpr uint32_t SPEED_SCALE = WHEEL_CIRCUMFERENCE_INCHES * 56818.18 + 0.5;
+//distance in tenths of a mile = wheel pulses * TENTHS_OF_MILE_PER_PULSE_Q24 >> 24 (0.1 mile = 6336 in)
+constexpr uint32_t TENTHS_OF_MILE_PER_PULSE_Q24 = WHEEL_CIRCUMFERENCE_INCHES / 6336 * 16777216 + 0.5;
+constexpr uint32_t PULSES_PER_MILE = 63360 / WHEEL_CIRCUMFERENCE_INCHES + 0.5;
+//speed in mph = motor RPM * RPM_TO_MPH_Q16 >> 16
+constexpr uint32_t RPM_TO_MPH_Q16 = WHEEL_CIRCUMFERENCE_INCHES * 60 / 63360 / Vehicle::motorToWheelRatio * 65536 + 0.5;
+//sensor value = (10 bit reading * SCALE_Q16 >> 16) + minimum of the sensor range, rounded so ranges that
+//don't divide by 1024 stay accurate at the top of the scale
+constexpr int32_t CURRENT_SCALE_Q16 = ((BatteryPack::maxCurrent - BatteryPack::minCurrent) * 65536L + 512) / 1024;
+constexpr int32_t TEMP_SCALE_Q16 = ((BatteryPack::maxTemp - BatteryPack::minTemp) * 65536L + 512) / 1024;
+//percentage of the voltage window = (voltage - minVoltage) * VOLTAGE_PERCENT_SCALE_Q16 >> 16
+constexpr uint32_t VOLTAGE_PERCENT_SCALE_Q16 = 100 * 65536L / (BatteryPack::maxVoltage - BatteryPack::minVoltage);
+//pixels per ampere or degree on the charging page's bar graphs, which are 100 pixels either side of 0, scaled by 2^8
+constexpr int16_t CURRENT_BAR_SCALE_Q8 = 100 * 256L / (-BatteryPack::minCurrent > BatteryPack::maxCurrent ? -BatteryPack::minCurrent : BatteryPack::maxCurrent);
+constexpr int16_t TEMP_BAR_SCALE_Q8 = 100 * 256L / (-BatteryPack::minTemp > BatteryPack::maxTemp ? -BatteryPack::minTemp : BatteryPack::maxTemp);
+
+static_assert(255 * (uint64_t)SPEED_SCALE <= 0xFFFFFFFF, "Wheel is too large for the speed calculation");
+static_assert(65535 * (uint64_t)RPM_TO_MPH_Q16 <= 0xFFFFFFFF, "Wheel is too large for the RPM to speed calculation");
+
+/*
+  Returns the state of charge in percent from the battery profile's curve
+  @param voltage is the battery voltage in millivolts
+*/
+inline uint8_t stateOfCharge(uint16_t voltage) {
+  constexpr const uint16_t* curve = BatteryPack::socCurve;
+  uint16_t lowerVoltage = pgm_read_word(&curve[0]);
+  if (voltage <= lowerVoltage) {
+    return 0;
+  }
+
+  //interpolate within the 10% segment of the curve the voltage falls in
+  for (uint8_t point = 1; point < SOC_CURVE_POINTS; ++point) {
+    uint16_t upperVoltage = pgm_read_word(&curve[point]);
+    if (voltage < upperVoltage) {
+      return (point - 1) * 10 + (uint32_t)(voltage - lowerVoltage) * 10 / (upperVoltage - lowerVoltage);
+    }
+    lowerVoltage = upperVoltage;
+  }
+  return 100;
+}
+
+#endif
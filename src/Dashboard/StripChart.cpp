@@ -0,0 +1,111 @@
+#include "StripChart.h"
+
+//RA8875 block transfer engine registers
+#define RA8875_BECR0 0x50 //control, bit 7 starts the transfer and reads 1 while it's busy
+#define RA8875_BECR1 0x51 //raster operation (upper 4 bits) and operation (lower 4 bits)
+#define RA8875_HSBE0 0x54 //source x
+#define RA8875_VSBE0 0x56 //source y
+#define RA8875_HDBE0 0x58 //destination x
+#define RA8875_VDBE0 0x5A //destination y
+#define RA8875_BEWR0 0x5C //width
+#define RA8875_BEHR0 0x5E //height
+#define RA8875_BECR0_START 0x80
+#define RA8875_BTE_MOVE_POSITIVE 0xC2 //copy the source unchanged, moving left to right and top to bottom
+
+/*
+   Constructor
+*/
+StripChart::StripChart(uint16_t x, uint16_t y, long minValue, long maxValue, uint16_t color)
+  : m_x(x), m_y(y), m_minValue(minValue), m_maxValue(maxValue), m_color(color)
+  , m_newestSample(0), m_sampleCount(0)
+{
+}
+
+void StripChart::clear() {
+  m_newestSample = 0;
+  m_sampleCount = 0;
+}
+
+void StripChart::addSample(long value) {
+  m_newestSample = (m_newestSample + 1) % STRIP_CHART_WIDTH;
+  m_samples[m_newestSample] = scale(value);
+  if (m_sampleCount < STRIP_CHART_WIDTH) {
+    ++m_sampleCount;
+  }
+}
+
+void StripChart::drawNewestSample(Adafruit_RA8875& display) {
+  if (m_sampleCount == 0) {
+    return;
+  }
+  display.graphicsMode();
+  shiftLeft(display);
+
+  //the first sample has no previous one to connect to
+  uint8_t previousSample = (m_newestSample + STRIP_CHART_WIDTH - 1) % STRIP_CHART_WIDTH;
+  uint8_t previousHeight = (m_sampleCount > 1) ? m_samples[previousSample] : m_samples[m_newestSample];
+  drawColumn(display, m_x + STRIP_CHART_WIDTH - 1, previousHeight, m_samples[m_newestSample]);
+}
+
+void StripChart::draw(Adafruit_RA8875& display) {
+  display.graphicsMode();
+  display.drawRect(m_x - 1, m_y - 1, STRIP_CHART_WIDTH + 2, STRIP_CHART_HEIGHT + 2, RA8875_BLACK);
+  display.fillRect(m_x, m_y, STRIP_CHART_WIDTH, STRIP_CHART_HEIGHT, RA8875_WHITE);
+
+  //the newest sample is in the rightmost column
+  uint8_t sample = (m_newestSample + STRIP_CHART_WIDTH - m_sampleCount + 1) % STRIP_CHART_WIDTH;
+  uint8_t previousHeight = m_samples[sample];
+  for (uint16_t column = m_x + STRIP_CHART_WIDTH - m_sampleCount; column < m_x + STRIP_CHART_WIDTH; ++column) {
+    drawColumn(display, column, previousHeight, m_samples[sample]);
+    previousHeight = m_samples[sample];
+    sample = (sample + 1) % STRIP_CHART_WIDTH;
+  }
+}
+
+/*
+
+
+
+    Private helper functions
+
+
+
+*/
+
+uint8_t StripChart::scale(long value) {
+  if (value <= m_minValue) {
+    return 0;
+  }
+  if (value >= m_maxValue) {
+    return STRIP_CHART_HEIGHT - 1;
+  }
+  return (value - m_minValue) * (STRIP_CHART_HEIGHT - 1) / (m_maxValue - m_minValue);
+}
+
+void StripChart::drawColumn(Adafruit_RA8875& display, uint16_t column, uint8_t previousHeight, uint8_t height) {
+  //clear the column, then draw a vertical line between the two heights so the plot stays continuous
+  uint16_t bottom = m_y + STRIP_CHART_HEIGHT - 1;
+  display.fillRect(column, m_y, 1, STRIP_CHART_HEIGHT, RA8875_WHITE);
+  display.drawLine(column, bottom - previousHeight, column, bottom - height, m_color);
+}
+
+void StripChart::shiftLeft(Adafruit_RA8875& display) {
+  //moving left to right is safe for overlapping areas when the destination is left of the source
+  uint16_t sourceX = m_x + 1;
+  uint16_t width = STRIP_CHART_WIDTH - 1;
+  display.writeReg(RA8875_HSBE0, sourceX & 0xFF);
+  display.writeReg(RA8875_HSBE0 + 1, sourceX >> 8);
+  display.writeReg(RA8875_VSBE0, m_y & 0xFF);
+  display.writeReg(RA8875_VSBE0 + 1, m_y >> 8);
+  display.writeReg(RA8875_HDBE0, m_x & 0xFF);
+  display.writeReg(RA8875_HDBE0 + 1, m_x >> 8);
+  display.writeReg(RA8875_VDBE0, m_y & 0xFF);
+  display.writeReg(RA8875_VDBE0 + 1, m_y >> 8);
+  display.writeReg(RA8875_BEWR0, width & 0xFF);
+  display.writeReg(RA8875_BEWR0 + 1, width >> 8);
+  display.writeReg(RA8875_BEHR0, STRIP_CHART_HEIGHT & 0xFF);
+  display.writeReg(RA8875_BEHR0 + 1, STRIP_CHART_HEIGHT >> 8);
+  display.writeReg(RA8875_BECR1, RA8875_BTE_MOVE_POSITIVE);
+  display.writeReg(RA8875_BECR0, RA8875_BECR0_START);
+  display.waitPoll(RA8875_BECR0, RA8875_BECR0_START);
+}
@@ -0,0 +1,68 @@
+/*
+  Rolling strip chart for the display. The samples are kept in a ring buffer so the chart can be
+  redrawn at any time, and a new sample only draws one new column: the rest of the plot is shifted
+  left by the RA8875's block transfer engine instead of being redrawn.
+*/
+
+#ifndef STRIP_CHART_H
+#define STRIP_CHART_H
+
+#include <Arduino.h>
+#include <Adafruit_RA8875.h>
+
+//size of the plot area in pixels, one column per sample
+#define STRIP_CHART_WIDTH 160
+#define STRIP_CHART_HEIGHT 60
+
+class StripChart {
+
+  private:
+    uint16_t m_x; //top left corner of the plot area
+    uint16_t m_y;
+    long m_minValue; //value at the bottom of the plot area
+    long m_maxValue; //value at the top of the plot area
+    uint16_t m_color;
+    uint8_t m_samples[STRIP_CHART_WIDTH]; //height of each sample in pixels
+    uint8_t m_newestSample; //index of the newest sample in m_samples
+    uint8_t m_sampleCount;
+
+    /*
+      Returns the height of a value in pixels, clamped to the plot area
+    */
+    uint8_t scale(long value);
+    /*
+      Draws a column of the plot with a line from the previous sample's height to the new sample's height
+      @param column is the x position of the column on the display
+    */
+    void drawColumn(Adafruit_RA8875& display, uint16_t column, uint8_t previousHeight, uint8_t height);
+    /*
+      Moves the plot area one column to the left with the block transfer engine
+    */
+    void shiftLeft(Adafruit_RA8875& display);
+
+  public:
+    /*
+      @param x, y are the top left corner of the plot area
+      @param minValue, maxValue are the values at the bottom and the top of the plot area
+      @param color is the color of the plotted line
+    */
+    StripChart(uint16_t x, uint16_t y, long minValue, long maxValue, uint16_t color);
+    /*
+      Removes all samples, doesn't change the display
+    */
+    void clear();
+    /*
+      Adds a sample to the history, doesn't change the display
+    */
+    void addSample(long value);
+    /*
+      Scrolls the chart on the display by one column and draws the newest sample in it
+    */
+    void drawNewestSample(Adafruit_RA8875& display);
+    /*
+      Draws the frame and every sample in the history
+    */
+    void draw(Adafruit_RA8875& display);
+};
+
+#endif
@@ -0,0 +1,143 @@
+#include "Telemetry.h"
+#include "Crc8.h"
+
+//ring buffer of received bytes
+volatile uint8_t telemetryBuffer[TELEMETRY_BUFFER_SIZE];
+volatile uint8_t telemetryHead = 0; //only written by receive()
+volatile uint8_t telemetryTail = 0; //only written by the main loop
+volatile uint16_t telemetryOverruns = 0;
+
+/*
+   Constructor
+*/
+Telemetry::Telemetry()
+  : m_packetStart(0), m_packetLength(0), m_hasPacket(false)
+  , m_packetCount(0), m_crcErrors(0)
+{
+}
+
+void Telemetry::begin() {
+#ifdef USART1_RX_vect
+  //the receive interrupt is implemented below, so Serial1 can't be used at the same time
+  UCSR1A = _BV(U2X1);
+  UBRR1 = (F_CPU / 8 / TELEMETRY_BAUD_RATE) - 1;
+  UCSR1C = _BV(UCSZ11) | _BV(UCSZ10); //8 data bits, no parity, 1 stop bit
+  UCSR1B = _BV(RXEN1) | _BV(RXCIE1);
+#endif
+}
+
+bool Telemetry::nextPacket() {
+  while (true) {
+    uint8_t tail = telemetryTail;
+    uint8_t available = telemetryHead - tail;
+    if (available < TELEMETRY_PACKET_OVERHEAD) {
+      return false;
+    }
+
+    //skip bytes until a sync byte followed by a plausible length
+    uint8_t length = telemetryBuffer[(uint8_t)(tail + 1)];
+    if (telemetryBuffer[tail] != TELEMETRY_SYNC || length > TELEMETRY_MAX_PAYLOAD) {
+      telemetryTail = tail + 1;
+      continue;
+    }
+
+    //wait for the rest of the packet
+    if (available < length + TELEMETRY_PACKET_OVERHEAD) {
+      return false;
+    }
+
+    //check the CRC of length, type and payload in place, in two parts if they wrap around the end of the ring buffer
+    //the interrupt doesn't write to these bytes until they're consumed, so they can be read as non-volatile
+    const uint8_t* buffer = (const uint8_t*)telemetryBuffer;
+    uint8_t start = tail + 1;
+    uint8_t crcLength = length + 2;
+    uint8_t firstLength = crcLength;
+    if (start + crcLength > TELEMETRY_BUFFER_SIZE) {
+      firstLength = TELEMETRY_BUFFER_SIZE - start;
+    }
+    uint8_t crc = crc8(buffer + start, firstLength);
+    crc = crc8(buffer, crcLength - firstLength, crc);
+    if (crc != telemetryBuffer[(uint8_t)(tail + length + 3)]) {
+      //the sync byte might have been part of another packet, look for the next one
+      ++m_crcErrors;
+      telemetryTail = tail + 1;
+      continue;
+    }
+
+    m_packetStart = tail;
+    m_packetLength = length;
+    m_hasPacket = true;
+    ++m_packetCount;
+    return true;
+  }
+}
+
+void Telemetry::consumePacket() {
+  if (m_hasPacket) {
+    telemetryTail = m_packetStart + m_packetLength + TELEMETRY_PACKET_OVERHEAD;
+    m_hasPacket = false;
+  }
+}
+
+uint8_t Telemetry::packetType() {
+  return telemetryBuffer[(uint8_t)(m_packetStart + 2)];
+}
+
+uint8_t Telemetry::packetLength() {
+  return m_packetLength;
+}
+
+uint8_t Telemetry::readByte(uint8_t offset) {
+  //the payload starts after the sync, length and type bytes
+  return telemetryBuffer[(uint8_t)(m_packetStart + 3 + offset)];
+}
+
+uint16_t Telemetry::readWord(uint8_t offset) {
+  return readByte(offset) | ((uint16_t)readByte(offset + 1) << 8);
+}
+
+uint16_t Telemetry::packetCount() {
+  return m_packetCount;
+}
+
+uint16_t Telemetry::crcErrors() {
+  return m_crcErrors;
+}
+
+void Telemetry::receive(uint8_t data) {
+  uint8_t head = telemetryHead;
+  if ((uint8_t)(head + 1) == telemetryTail) {
+    ++telemetryOverruns;
+    return;
+  }
+  telemetryBuffer[head] = data;
+  telemetryHead = head + 1;
+}
+
+uint8_t Telemetry::encodePacket(uint8_t type, const uint8_t* payload, uint8_t length, uint8_t* packet) {
+  packet[0] = TELEMETRY_SYNC;
+  packet[1] = length;
+  packet[2] = type;
+  memcpy(packet + 3, payload, length);
+
+  packet[length + 3] = crc8(packet + 1, length + 2);
+  return length + TELEMETRY_PACKET_OVERHEAD;
+}
+
+uint16_t Telemetry::overruns() {
+  noInterrupts();
+  uint16_t count = telemetryOverruns;
+  interrupts();
+  return count;
+}
+
+#ifdef USART1_RX_vect
+ISR(USART1_RX_vect) {
+  //drop bytes with framing errors, reading UDR1 clears the interrupt either way
+  bool hasFrameError = UCSR1A & _BV(FE1);
+  uint8_t data = UDR1;
+  if (!hasFrameError) {
+    Telemetry::receive(data);
+  }
+}
+#endif
@@ -0,0 +1,87 @@
+/*
+  Telemetry from the motor controller and the BMS over a UART. Received bytes go into a ring buffer
+  from the USART's receive interrupt, and packets are checked and read in place in the ring buffer,
+  without being copied out.
+
+  Packet format, multi-byte values are little endian:
+    SYNC (0xAA), LENGTH (of the payload), TYPE, PAYLOAD (LENGTH bytes), CRC-8 of LENGTH, TYPE & PAYLOAD
+*/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+
+//the ring buffer is 256 bytes so its 8 bit indices wrap around on their own, it has to hold everything
+//received between two reads, which happen at the start of every task of the dashboard's loop
+#define TELEMETRY_BUFFER_SIZE 256
+#define TELEMETRY_SYNC 0xAA
+#define TELEMETRY_MAX_PAYLOAD 32
+//bytes in a packet besides the payload: sync, length, type and CRC
+#define TELEMETRY_PACKET_OVERHEAD 4
+#define TELEMETRY_BAUD_RATE 115200
+#define TELEMETRY_MAX_CELLS 16
+
+//list of packet types and their payloads
+enum TelemetryPacketTypes {
+  //motor RPM (uint16), phase current in 0.1A (int16), controller temperature in celsius (int8), fault flags (uint8)
+  CONTROLLER_STATUS_PACKET = 0x01,
+  //pack voltage in mV (uint16), pack current in 0.1A (int16), pack temperature in celsius (int8),
+  //state of charge in percent (uint8), fault flags (uint8)
+  BMS_STATUS_PACKET = 0x02,
+  //index of the first cell (uint8), followed by up to 15 cell voltages in mV (uint16)
+  BMS_CELLS_PACKET = 0x03,
+};
+
+class Telemetry {
+
+  private:
+    uint8_t m_packetStart; //ring buffer index of the current packet's sync byte
+    uint8_t m_packetLength; //payload length of the current packet
+    bool m_hasPacket;
+    uint16_t m_packetCount; //valid packets received
+    uint16_t m_crcErrors; //packets dropped because of a wrong CRC
+
+  public:
+    Telemetry();
+    /*
+      Starts receiving on the USART at TELEMETRY_BAUD_RATE
+    */
+    void begin();
+    /*
+      Finds the next complete packet with a valid CRC in the ring buffer, skipping any garbage before it
+      Returns false if there's no complete packet yet
+    */
+    bool nextPacket();
+    /*
+      Removes the current packet from the ring buffer, call once done reading it
+    */
+    void consumePacket();
+    uint8_t packetType();
+    uint8_t packetLength();
+    /*
+      Read values from the current packet's payload in place
+      @param offset is the offset of the value in the payload
+    */
+    uint8_t readByte(uint8_t offset);
+    uint16_t readWord(uint8_t offset);
+    uint16_t packetCount();
+    uint16_t crcErrors();
+    /*
+      Adds a received byte to the ring buffer, drops it if the buffer is full
+      Called from the USART's interrupt, or with generated packets by the host test harness
+    */
+    static void receive(uint8_t data);
+    /*
+      Writes a packet into a buffer
+      @param packet is the buffer, it needs room for length + TELEMETRY_PACKET_OVERHEAD bytes
+      Returns the number of bytes written
+    */
+    static uint8_t encodePacket(uint8_t type, const uint8_t* payload, uint8_t length, uint8_t* packet);
+    /*
+      Returns the number of bytes dropped because the ring buffer was full
+    */
+    static uint16_t overruns();
+};
+
+#endif
@@ -0,0 +1,40 @@
+/*
+  Just enough of the Arduino core to build the performance timer on the host
+*/
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#define PI 3.1415926535897932384626433832795
+#define HEX 16
+#define DEC 10
+//flash and RAM are the same on the host
+#define PROGMEM
+#define pgm_read_word(address) (*(const uint16_t*)(address))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+
+template <class T> T constrain(T value, T low, T high) {
+  return value < low ? low : (value > high ? high : value);
+}
+
+//the test sets the time the pulses are read at
+unsigned long micros();
+unsigned long millis();
+
+//the host has no interrupts to hold off
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+//the debug output is dropped
+struct HardwareSerial {
+  template <class T> void print(T, int = DEC) {}
+  template <class T> void println(T, int = DEC) {}
+};
+extern HardwareSerial Serial;
+
+#endif
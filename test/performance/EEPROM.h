@@ -0,0 +1,33 @@
+/*
+  EEPROM kept in RAM, so the test can check what the performance timer saves
+*/
+
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define HOST_EEPROM_SIZE 4096
+
+struct EEPROMClass {
+  uint8_t bytes[HOST_EEPROM_SIZE];
+
+  uint8_t read(int address) {
+    return bytes[address];
+  }
+  void update(int address, uint8_t value) {
+    bytes[address] = value;
+  }
+  template <class T> T& get(int address, T& value) {
+    memcpy(&value, bytes + address, sizeof(T));
+    return value;
+  }
+  template <class T> const T& put(int address, const T& value) {
+    memcpy(bytes + address, &value, sizeof(T));
+    return value;
+  }
+};
+extern EEPROMClass EEPROM;
+
+#endif
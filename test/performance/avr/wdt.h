@@ -0,0 +1,10 @@
+/*
+  The host has no watchdog, the loop monitor's header only needs this to be there
+*/
+
+#ifndef AVR_WDT_H
+#define AVR_WDT_H
+
+inline void wdt_reset() {}
+
+#endif
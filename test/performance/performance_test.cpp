@@ -0,0 +1,202 @@
+/*
+  Host tests of the performance timer. Pulses of a wheel under constant acceleration are fed through the
+  ring buffer, and the interpolated times are checked against the exact ones. The speed crossings are only
+  as exact as the speeds, which are measured to a tick of micros() over one pulse, so on the bench's small
+  wheel at a low acceleration they're allowed more than TOLERANCE_MS.
+  Build and run with "make test" in this folder.
+*/
+
+#include <cmath>
+#include <cstdio>
+#include "PerformanceTimer.h"
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+
+enum TestConstants {
+  //the interpolated times have to be within this of the exact ones
+  TOLERANCE_MS = 1,
+  //micros() counts in steps of 4us on a 16MHz board
+  MICROS_RESOLUTION = 4,
+  //pulses recorded between two updates, within the ring buffer
+  PULSES_PER_UPDATE = 8,
+  RUN_START_US = 5000000,
+  //pulses recorded at once to overrun the ring buffer
+  OVERRUN_PULSES = PERFORMANCE_BUFFER_SIZE + 8,
+};
+
+//1 mph = 17.6 in/s
+constexpr double INCHES_PER_SECOND_PER_MPH = 17.6;
+
+static unsigned long currentMicros = 0;
+static int failures = 0;
+
+unsigned long micros() {
+  return currentMicros;
+}
+
+unsigned long millis() {
+  return currentMicros / 1000;
+}
+
+static void check(bool condition, const char* message) {
+  if (!condition) {
+    printf("FAILED: %s\n", message);
+    ++failures;
+  }
+}
+
+static void checkTime(uint16_t time, double exactTime, const char* message, double tolerance = TOLERANCE_MS) {
+  if (fabs(time - exactTime) > tolerance) {
+    printf("FAILED: %s is %u ms, exactly %.2f ms, tolerance %.1f ms\n", message, time, exactTime, tolerance);
+    ++failures;
+  }
+}
+
+/*
+  Wheel starting from a standstill at RUN_START_US with a constant acceleration
+*/
+struct Run {
+  double acceleration; //in mph/s
+  double firstPulseFraction; //part of the circumference the wheel turns before the first pulse
+  bool hasBouncedPulses; //every pulse is recorded twice in the same tick of micros()
+
+  /*
+    Returns the time of a pulse in microseconds, rounded like micros()
+  */
+  unsigned long pulseTime(uint32_t pulse) const {
+    double distance = (firstPulseFraction + pulse) * WHEEL_CIRCUMFERENCE_INCHES;
+    double seconds = sqrt(2 * distance / (acceleration * INCHES_PER_SECOND_PER_MPH));
+    unsigned long time = RUN_START_US + llround(seconds * 1e6);
+    return time / MICROS_RESOLUTION * MICROS_RESOLUTION;
+  }
+  double exactTime(double speed) const {
+    return speed / acceleration * 1000;
+  }
+  /*
+    Returns the tolerance of the time a speed is reached, TOLERANCE_MS or the error of a speed measured one tick off
+  */
+  double speedTimeTolerance(double speed) const {
+    double pulseInterval = WHEEL_CIRCUMFERENCE_INCHES / (speed * INCHES_PER_SECOND_PER_MPH) * 1e6;
+    double speedError = speed * MICROS_RESOLUTION / pulseInterval;
+    return fmax(TOLERANCE_MS, speedError / acceleration * 1000);
+  }
+  double exactQuarterMileTime() const {
+    return sqrt(2 * QUARTER_MILE_INCHES / (acceleration * INCHES_PER_SECOND_PER_MPH)) * 1000;
+  }
+};
+
+/*
+  Starts the timer on a stopped vehicle, so the next pulse starts a run
+*/
+static void startTimer(PerformanceTimer& timer) {
+  timer.setEnabled(false);
+  currentMicros = 0;
+  timer.setEnabled(true);
+  currentMicros = PERFORMANCE_STANDSTILL_MS * 1000UL + 1;
+  timer.update();
+}
+
+/*
+  Feeds pulses until the run ends
+  @param overrunPulse is the pulse at which more pulses than the ring buffer holds are recorded at once
+  Returns the number of pulses fed
+*/
+static uint32_t feedRun(PerformanceTimer& timer, const Run& run, uint32_t overrunPulse = 0xFFFFFFFF) {
+  uint32_t pulse = 0;
+  while (pulse == 0 || timer.state() == PERFORMANCE_RUNNING) {
+    uint32_t pulseCount = pulse == overrunPulse ? OVERRUN_PULSES : PULSES_PER_UPDATE;
+    for (uint32_t i = 0; i < pulseCount; ++i, ++pulse) {
+      PerformanceTimer::recordPulse(run.pulseTime(pulse));
+      if (run.hasBouncedPulses) {
+        PerformanceTimer::recordPulse(run.pulseTime(pulse));
+      }
+      currentMicros = run.pulseTime(pulse);
+    }
+    timer.update();
+  }
+  return pulse;
+}
+
+/*
+  The 0-30, 0-60 and quarter mile times of runs at different accelerations and wheel positions are within
+  TOLERANCE_MS, and the best run is saved
+*/
+static void testRunTimes(bool hasBouncedPulses) {
+  const double accelerations[] = {4, 8, 12};
+  const double firstPulseFractions[] = {0.02, 0.37, 0.81, 0.99};
+  PerformanceTimer timer;
+  timer.clearBestRun();
+
+  for (double acceleration : accelerations) {
+    for (double firstPulseFraction : firstPulseFractions) {
+      Run run = {acceleration, firstPulseFraction, hasBouncedPulses};
+      startTimer(timer);
+      feedRun(timer, run);
+
+      const PerformanceRecord& lastRun = timer.lastRun();
+      printf("%4.0f mph/s, first pulse at %.2f: 0-30 %u ms (%.1f), 0-60 %u ms (%.1f), 1/4 mile %u ms (%.1f)\n",
+             acceleration, firstPulseFraction, lastRun.lowSpeedTime, run.exactTime(PERFORMANCE_LOW_SPEED),
+             lastRun.highSpeedTime, run.exactTime(PERFORMANCE_HIGH_SPEED), lastRun.quarterMileTime, run.exactQuarterMileTime());
+      checkTime(lastRun.lowSpeedTime, run.exactTime(PERFORMANCE_LOW_SPEED), "0-30 time", run.speedTimeTolerance(PERFORMANCE_LOW_SPEED));
+      checkTime(lastRun.highSpeedTime, run.exactTime(PERFORMANCE_HIGH_SPEED), "0-60 time", run.speedTimeTolerance(PERFORMANCE_HIGH_SPEED));
+      checkTime(lastRun.quarterMileTime, run.exactQuarterMileTime(), "quarter mile time");
+      double trapSpeed = acceleration * run.exactQuarterMileTime() / 1000;
+      check(fabs(lastRun.trapSpeed - trapSpeed) <= 1, "trap speed");
+      check(timer.state() == PERFORMANCE_WAITING, "a finished run waits for a standstill");
+    }
+  }
+
+  //the fastest run is the best one, and it's loaded again from the EEPROM
+  Run fastestRun = {accelerations[2], 0, false};
+  PerformanceTimer loadedTimer;
+  loadedTimer.begin();
+  checkTime(loadedTimer.bestRun().highSpeedTime, fastestRun.exactTime(PERFORMANCE_HIGH_SPEED), "saved best 0-60 time",
+            fastestRun.speedTimeTolerance(PERFORMANCE_HIGH_SPEED));
+  checkTime(loadedTimer.bestRun().quarterMileTime, fastestRun.exactQuarterMileTime(), "saved best quarter mile time");
+  timer.setEnabled(false);
+}
+
+/*
+  A run that drops pulses is aborted and doesn't replace the best run
+*/
+static void testOverrunAbort() {
+  PerformanceTimer timer;
+  timer.clearBestRun();
+  PerformanceRecord savedRun;
+  EEPROM.get(PERFORMANCE_EEPROM_ADDR, savedRun);
+  uint16_t overruns = PerformanceTimer::overruns();
+
+  Run run = {8, 0.5, false};
+  startTimer(timer);
+  uint32_t pulseCount = feedRun(timer, run, 4 * PULSES_PER_UPDATE);
+
+  printf("Overrun: run aborted after %u pulses, %u pulses dropped\n", (unsigned)pulseCount, PerformanceTimer::overruns() - overruns);
+  check(PerformanceTimer::overruns() - overruns == OVERRUN_PULSES - PERFORMANCE_BUFFER_SIZE, "overrun count");
+  check(timer.state() == PERFORMANCE_WAITING, "an aborted run waits for a standstill");
+  check(pulseCount == 4 * PULSES_PER_UPDATE + OVERRUN_PULSES, "the run was aborted at the overrun");
+  check(timer.lastRun().lowSpeedTime == PERFORMANCE_NO_TIME, "an aborted run has no times");
+  PerformanceRecord runAfterAbort;
+  EEPROM.get(PERFORMANCE_EEPROM_ADDR, runAfterAbort);
+  check(memcmp(&savedRun, &runAfterAbort, sizeof(PerformanceRecord)) == 0, "an aborted run was saved");
+
+  //the next run after a standstill is timed again
+  startTimer(timer);
+  feedRun(timer, run);
+  checkTime(timer.lastRun().quarterMileTime, run.exactQuarterMileTime(), "quarter mile time after an abort");
+  timer.setEnabled(false);
+}
+
+int main() {
+  printf("Wheel circumference %.2f in\n", WHEEL_CIRCUMFERENCE_INCHES);
+  testRunTimes(false);
+  printf("Every pulse bounced:\n");
+  testRunTimes(true);
+  testOverrunAbort();
+  if (failures > 0) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("All checks passed\n");
+  return 0;
+}
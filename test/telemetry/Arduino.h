@@ -0,0 +1,15 @@
+/*
+  Just enough of the Arduino core to build the telemetry parser on the host
+*/
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <string.h>
+
+//the host has no receive interrupt to hold off
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+#endif
@@ -0,0 +1,77 @@
+#include "TelemetrySimulator.h"
+
+/*
+   Constructor
+*/
+TelemetrySimulator::TelemetrySimulator()
+  : m_step(0)
+{
+}
+
+void TelemetrySimulator::nextRideStep() {
+  //accelerate for the first half of the ride and brake for the second half
+  uint16_t halfRide = SIMULATOR_RIDE_STEPS / 2;
+  bool isAccelerating = m_step < halfRide;
+  uint16_t rampStep = isAccelerating ? m_step : SIMULATOR_RIDE_STEPS - m_step;
+  uint16_t rpm = (uint32_t)rampStep * SIMULATOR_MAX_RPM / halfRide;
+  //draw current while accelerating, regenerate while braking, in 0.1A
+  int16_t current = isAccelerating ? 300 + rpm / 20 : -150;
+  uint16_t packVoltage = SIMULATOR_PACK_VOLTAGE - current * 2;
+  int8_t temperature = 25 + rpm / 500;
+
+  uint8_t controllerPayload[] = {
+    (uint8_t)rpm, (uint8_t)(rpm >> 8),
+    (uint8_t)current, (uint8_t)(current >> 8),
+    (uint8_t)(temperature + 10),
+    0, //no faults
+  };
+  setPacket(0, CONTROLLER_STATUS_PACKET, controllerPayload, sizeof(controllerPayload));
+
+  uint8_t bmsPayload[] = {
+    (uint8_t)packVoltage, (uint8_t)(packVoltage >> 8),
+    (uint8_t)current, (uint8_t)(current >> 8),
+    (uint8_t)temperature,
+    (uint8_t)(80 - m_step / 60), //state of charge
+    0, //no faults
+  };
+  setPacket(1, BMS_STATUS_PACKET, bmsPayload, sizeof(bmsPayload));
+
+  //cell voltages are split over two packets, the last cell drifts away from the others
+  for (uint8_t firstCell = 0; firstCell < SIMULATOR_CELL_COUNT; firstCell += 8) {
+    uint8_t cellPayload[1 + 8 * 2];
+    cellPayload[0] = firstCell;
+    for (uint8_t i = 0; i < 8; ++i) {
+      uint16_t cellVoltage = packVoltage / SIMULATOR_CELL_COUNT;
+      if (firstCell + i == SIMULATOR_CELL_COUNT - 1) {
+        cellVoltage -= m_step / 4;
+      }
+      cellPayload[1 + i * 2] = cellVoltage;
+      cellPayload[2 + i * 2] = cellVoltage >> 8;
+    }
+    setPacket(2 + firstCell / 8, BMS_CELLS_PACKET, cellPayload, sizeof(cellPayload));
+  }
+
+  m_step = (m_step + 1) % SIMULATOR_RIDE_STEPS;
+}
+
+const SimulatorPacket& TelemetrySimulator::packet(uint8_t index) {
+  return m_packets[index];
+}
+
+/*
+
+
+
+    Private helper functions
+
+
+
+*/
+
+void TelemetrySimulator::setPacket(uint8_t index, uint8_t type, const uint8_t* payload, uint8_t length) {
+  SimulatorPacket& packet = m_packets[index];
+  packet.type = type;
+  packet.length = length;
+  memcpy(packet.payload, payload, length);
+  packet.byteCount = Telemetry::encodePacket(type, payload, length, packet.bytes);
+}
@@ -0,0 +1,51 @@
+/*
+  Stand-in for the motor controller and the BMS. It generates a simulated ride as encoded telemetry
+  packets, so the packet parser can be tested and benchmarked on the host without the real hardware.
+*/
+
+#ifndef TELEMETRY_SIMULATOR_H
+#define TELEMETRY_SIMULATOR_H
+
+#include <Arduino.h>
+#include "Telemetry.h"
+
+enum TelemetrySimulatorConstants {
+  SIMULATOR_RIDE_STEPS = 600, //steps in one ride cycle, accelerating and then braking
+  SIMULATOR_MAX_RPM = 6000,
+  SIMULATOR_PACK_VOLTAGE = 52000, //in mV, with no current
+  SIMULATOR_CELL_COUNT = 16,
+  //a controller status, a BMS status and two cell voltage packets
+  SIMULATOR_PACKETS_PER_STEP = 4,
+};
+
+//a packet as sent, to compare with what the parser reads
+struct SimulatorPacket {
+  uint8_t type;
+  uint8_t length;
+  uint8_t payload[TELEMETRY_MAX_PAYLOAD];
+  uint8_t bytes[TELEMETRY_MAX_PAYLOAD + TELEMETRY_PACKET_OVERHEAD]; //encoded packet
+  uint8_t byteCount;
+};
+
+class TelemetrySimulator {
+
+  private:
+    uint16_t m_step; //position in the ride cycle
+    SimulatorPacket m_packets[SIMULATOR_PACKETS_PER_STEP];
+
+    void setPacket(uint8_t index, uint8_t type, const uint8_t* payload, uint8_t length);
+
+  public:
+    TelemetrySimulator();
+    /*
+      Generates the controller status, BMS status and cell voltage packets of the next step of the ride
+    */
+    void nextRideStep();
+    /*
+      Returns a packet of the last step
+      @param index is below SIMULATOR_PACKETS_PER_STEP, in the order they're sent
+    */
+    const SimulatorPacket& packet(uint8_t index);
+};
+
+#endif
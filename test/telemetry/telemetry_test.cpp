@@ -0,0 +1,208 @@
+/*
+  Host tests and benchmark of the telemetry parser, fed by the simulated controller and BMS.
+  Build and run with "make test" in this folder.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "Telemetry.h"
+#include "TelemetrySimulator.h"
+
+//ring buffer indices, emptied between the tests
+extern volatile uint8_t telemetryHead;
+extern volatile uint8_t telemetryTail;
+
+enum TestConstants {
+  RIDE_STEPS = 2 * SIMULATOR_RIDE_STEPS,
+  CORRUPTION_SEED = 1234,
+  //one packet in this many gets a bit flipped, and garbage is sent before one in this many
+  CORRUPT_PACKET_ODDS = 10,
+  GARBAGE_ODDS = 8,
+  MAX_GARBAGE_BYTES = 12,
+  OVERRUN_TEST_BYTES = 300,
+  BENCHMARK_PACKETS = 100000,
+};
+
+static int failures = 0;
+
+static void check(bool condition, const char* message) {
+  if (!condition) {
+    printf("FAILED: %s\n", message);
+    ++failures;
+  }
+}
+
+static void clearBuffer() {
+  telemetryTail = telemetryHead;
+}
+
+static void send(const uint8_t* bytes, uint8_t count) {
+  for (uint8_t i = 0; i < count; ++i) {
+    Telemetry::receive(bytes[i]);
+  }
+}
+
+static bool isSamePacket(Telemetry& telemetry, const SimulatorPacket& packet) {
+  if (telemetry.packetType() != packet.type || telemetry.packetLength() != packet.length) {
+    return false;
+  }
+  for (uint8_t i = 0; i < packet.length; ++i) {
+    if (telemetry.readByte(i) != packet.payload[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+  Every packet of a clean ride is read back with the values that were sent
+*/
+static void testCleanRide() {
+  clearBuffer();
+  Telemetry telemetry;
+  TelemetrySimulator simulator;
+  uint16_t mismatches = 0;
+
+  for (uint16_t step = 0; step < RIDE_STEPS; ++step) {
+    simulator.nextRideStep();
+    for (uint8_t i = 0; i < SIMULATOR_PACKETS_PER_STEP; ++i) {
+      const SimulatorPacket& packet = simulator.packet(i);
+      send(packet.bytes, packet.byteCount);
+    }
+    for (uint8_t i = 0; i < SIMULATOR_PACKETS_PER_STEP; ++i) {
+      if (!telemetry.nextPacket() || !isSamePacket(telemetry, simulator.packet(i))) {
+        ++mismatches;
+      }
+      telemetry.consumePacket();
+    }
+  }
+
+  printf("Clean ride: %u packets, %u CRC errors\n", telemetry.packetCount(), telemetry.crcErrors());
+  check(mismatches == 0, "clean ride packets read back wrong");
+  check(telemetry.packetCount() == RIDE_STEPS * SIMULATOR_PACKETS_PER_STEP, "clean ride packet count");
+  check(telemetry.crcErrors() == 0, "clean ride CRC errors");
+  check(!telemetry.nextPacket(), "clean ride left bytes behind");
+}
+
+/*
+  With flipped bits and garbage between the packets, every packet that arrived intact is still read in
+  order. A corrupted packet or garbage can pass the CRC by chance, and only such a false packet can
+  swallow an intact one, so the lost packets can't outnumber the false ones.
+*/
+static void testCorruption() {
+  clearBuffer();
+  srand(CORRUPTION_SEED);
+  Telemetry telemetry;
+  TelemetrySimulator simulator;
+  std::vector<SimulatorPacket> intactPackets;
+  size_t nextIntact = 0;
+  uint16_t corruptedCount = 0;
+  uint16_t garbageCount = 0;
+  uint16_t falseCount = 0;
+
+  for (uint16_t step = 0; step < RIDE_STEPS; ++step) {
+    simulator.nextRideStep();
+    for (uint8_t i = 0; i < SIMULATOR_PACKETS_PER_STEP; ++i) {
+      if (rand() % GARBAGE_ODDS == 0) {
+        uint8_t garbage[MAX_GARBAGE_BYTES];
+        uint8_t garbageLength = 1 + rand() % MAX_GARBAGE_BYTES;
+        for (uint8_t j = 0; j < garbageLength; ++j) {
+          //plenty of sync bytes so the parser has to check false starts
+          garbage[j] = rand() % 4 == 0 ? TELEMETRY_SYNC : rand();
+        }
+        send(garbage, garbageLength);
+        ++garbageCount;
+      }
+
+      SimulatorPacket packet = simulator.packet(i);
+      if (rand() % CORRUPT_PACKET_ODDS == 0) {
+        packet.bytes[rand() % packet.byteCount] ^= 1 << (rand() % 8);
+        ++corruptedCount;
+      } else {
+        intactPackets.push_back(packet);
+      }
+      send(packet.bytes, packet.byteCount);
+    }
+
+    while (telemetry.nextPacket()) {
+      //a packet that isn't the next intact one is either false, or a later one after some were lost
+      size_t match = nextIntact;
+      while (match < intactPackets.size() && !isSamePacket(telemetry, intactPackets[match])) {
+        ++match;
+      }
+      if (match < intactPackets.size()) {
+        nextIntact = match + 1;
+      } else {
+        ++falseCount;
+      }
+      telemetry.consumePacket();
+    }
+  }
+
+  size_t lostCount = intactPackets.size() - (telemetry.packetCount() - falseCount);
+  printf("Corruption: %u corrupted, %u garbage bursts, %u CRC errors, %u false packets, %u of %u intact packets lost\n",
+         corruptedCount, garbageCount, telemetry.crcErrors(), falseCount, (unsigned)lostCount, (unsigned)intactPackets.size());
+  check(nextIntact == intactPackets.size(), "corruption test didn't reach the last intact packet");
+  check(lostCount <= falseCount, "intact packets lost without a false packet");
+  check(telemetry.crcErrors() > 0, "corrupted packets weren't counted as CRC errors");
+  check(Telemetry::overruns() == 0, "corruption test overran the ring buffer");
+}
+
+/*
+  The ring buffer holds 255 bytes, any more are dropped and counted
+*/
+static void testOverruns() {
+  clearBuffer();
+  uint16_t overruns = Telemetry::overruns();
+  for (uint16_t i = 0; i < OVERRUN_TEST_BYTES; ++i) {
+    Telemetry::receive(0);
+  }
+  uint16_t expected = OVERRUN_TEST_BYTES - (TELEMETRY_BUFFER_SIZE - 1);
+  printf("Overruns: %u of %u bytes dropped\n", Telemetry::overruns() - overruns, OVERRUN_TEST_BYTES);
+  check(Telemetry::overruns() - overruns == expected, "overrun count");
+  clearBuffer();
+}
+
+/*
+  Times receiving and reading controller status packets, like the USART interrupt and the main loop do
+*/
+static void benchmark() {
+  clearBuffer();
+  Telemetry telemetry;
+  TelemetrySimulator simulator;
+  simulator.nextRideStep();
+  const SimulatorPacket& packet = simulator.packet(0);
+  uint16_t rpm = packet.payload[0] | (packet.payload[1] << 8);
+  uint32_t rpmSum = 0;
+
+  auto startTime = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < BENCHMARK_PACKETS; ++i) {
+    send(packet.bytes, packet.byteCount);
+    if (telemetry.nextPacket()) {
+      rpmSum += telemetry.readWord(0);
+      telemetry.consumePacket();
+    }
+  }
+  auto endTime = std::chrono::steady_clock::now();
+
+  double seconds = std::chrono::duration<double>(endTime - startTime).count();
+  printf("Throughput: %u packets in %.1f ms, %.0f ns per packet, %.1f MB/s\n", (unsigned)BENCHMARK_PACKETS,
+         seconds * 1000, seconds * 1e9 / BENCHMARK_PACKETS, BENCHMARK_PACKETS * packet.byteCount / seconds / 1e6);
+  check(telemetry.packetCount() == (uint16_t)BENCHMARK_PACKETS, "benchmark packet count");
+  check(rpmSum == (uint32_t)BENCHMARK_PACKETS * rpm, "benchmark packets read back wrong");
+}
+
+int main() {
+  testCleanRide();
+  testCorruption();
+  testOverruns();
+  benchmark();
+  if (failures > 0) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("All checks passed\n");
+  return 0;
+}